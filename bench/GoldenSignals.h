@@ -0,0 +1,146 @@
+/*
+NES-CVBS
+Copyright (c) 2023 Persune
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// hashes of the signal fields the reference encoder path (one thread, whole field) produces
+// for the golden corpus. regenerate with NES-CVBS-Bench --generate-golden, but only when
+// the encoder output is meant to change
+
+#include <cstdint>
+#include <cstddef>
+
+enum GoldenFrame {
+	golden_all_colors,
+	golden_emphasis_bars,
+	golden_frame_count
+};
+
+struct GoldenSignal {
+	int ppu_type;
+	int sync_enable;
+	int full_frame_input;
+	int frame_id;
+	int dot_phase;
+	int skip_dot;
+	uint64_t hash;
+};
+
+const GoldenSignal GoldenSignals[] = {
+	{ 0, 0, 0, 0, 0, 0, 0x53EED1374D992755ull },
+	{ 0, 0, 0, 0, 0, 1, 0xB8A69C974AB39CDBull },
+	{ 0, 0, 0, 0, 1, 0, 0x3D3126CE6120F5A5ull },
+	{ 0, 0, 0, 0, 1, 1, 0x8813BBB918F343EAull },
+	{ 0, 0, 0, 0, 2, 0, 0x655E4825049B0495ull },
+	{ 0, 0, 0, 0, 2, 1, 0x05537175D9BA9A74ull },
+	{ 0, 0, 0, 1, 0, 0, 0xF967B9D09E98E328ull },
+	{ 0, 0, 0, 1, 0, 1, 0x9CE06D4A77CA38AFull },
+	{ 0, 0, 0, 1, 1, 0, 0xD3AEAF993D6E6065ull },
+	{ 0, 0, 0, 1, 1, 1, 0xD899555204DD60E5ull },
+	{ 0, 0, 0, 1, 2, 0, 0xC366EBBEFE20E7DCull },
+	{ 0, 0, 0, 1, 2, 1, 0x57FE6B29E3B0CF67ull },
+	{ 0, 0, 1, 0, 0, 0, 0x7D64CA4A6F86EA16ull },
+	{ 0, 0, 1, 0, 0, 1, 0xAEEBDE57DF033652ull },
+	{ 0, 0, 1, 0, 1, 0, 0xCCC6A5BCDB0259F8ull },
+	{ 0, 0, 1, 0, 1, 1, 0x3F80E23036C222B5ull },
+	{ 0, 0, 1, 0, 2, 0, 0x1A7DDD965BE2E95Full },
+	{ 0, 0, 1, 0, 2, 1, 0x155081A448AD4007ull },
+	{ 0, 0, 1, 1, 0, 0, 0x25030572C9CF1997ull },
+	{ 0, 0, 1, 1, 0, 1, 0xAFA59F54A83E9128ull },
+	{ 0, 0, 1, 1, 1, 0, 0x90D6088C0856CA66ull },
+	{ 0, 0, 1, 1, 1, 1, 0x0B553843CBC29025ull },
+	{ 0, 0, 1, 1, 2, 0, 0x4E8EA260E4429A6Cull },
+	{ 0, 0, 1, 1, 2, 1, 0xD515F555A83A6DF8ull },
+	{ 0, 1, 0, 0, 0, 0, 0xB082EFE4AB642725ull },
+	{ 0, 1, 0, 0, 0, 1, 0x0C780F91A2CDF7CDull },
+	{ 0, 1, 0, 0, 1, 0, 0xF256B0077AEDF825ull },
+	{ 0, 1, 0, 0, 1, 1, 0xEC8F125716D7EA9Dull },
+	{ 0, 1, 0, 0, 2, 0, 0x993EC0D41C4A0425ull },
+	{ 0, 1, 0, 0, 2, 1, 0x309366D3796D2745ull },
+	{ 0, 1, 0, 1, 0, 0, 0x82260243E3C5CB8Cull },
+	{ 0, 1, 0, 1, 0, 1, 0xABC9EF19C282CD8Cull },
+	{ 0, 1, 0, 1, 1, 0, 0x6A516F3EC96C8484ull },
+	{ 0, 1, 0, 1, 1, 1, 0xA52BDD777FD80C84ull },
+	{ 0, 1, 0, 1, 2, 0, 0xA8ED9EF322CC8BE1ull },
+	{ 0, 1, 0, 1, 2, 1, 0x446F43E48DA401E1ull },
+	{ 0, 1, 1, 0, 0, 0, 0xB54D8D357160EB01ull },
+	{ 0, 1, 1, 0, 0, 1, 0xE6BA604D973E9AE9ull },
+	{ 0, 1, 1, 0, 1, 0, 0x11995F021BA8A78Full },
+	{ 0, 1, 1, 0, 1, 1, 0x68A322EE11122E57ull },
+	{ 0, 1, 1, 0, 2, 0, 0x438FBD9BF333EDCFull },
+	{ 0, 1, 1, 0, 2, 1, 0x4B880B3F96AF122Full },
+	{ 0, 1, 1, 1, 0, 0, 0xF368F2053B48F54Dull },
+	{ 0, 1, 1, 1, 0, 1, 0x1D0CDEDB1A05F74Dull },
+	{ 0, 1, 1, 1, 1, 0, 0xE23E5F440FC38086ull },
+	{ 0, 1, 1, 1, 1, 1, 0x1D18CD7CC62F0886ull },
+	{ 0, 1, 1, 1, 2, 0, 0x7A72D9403E968F12ull },
+	{ 0, 1, 1, 1, 2, 1, 0x15F47E31A96E0512ull },
+	{ 1, 0, 0, 0, 0, 0, 0x54B195E2CDA1A285ull },
+	{ 1, 0, 0, 0, 0, 1, 0x54B195E2CDA1A285ull },
+	{ 1, 0, 0, 0, 1, 0, 0x9BC16CD2E062AFE5ull },
+	{ 1, 0, 0, 0, 1, 1, 0x9BC16CD2E062AFE5ull },
+	{ 1, 0, 0, 0, 2, 0, 0xB373340D91410925ull },
+	{ 1, 0, 0, 0, 2, 1, 0xB373340D91410925ull },
+	{ 1, 0, 0, 1, 0, 0, 0x56A2B6279A0E09E1ull },
+	{ 1, 0, 0, 1, 0, 1, 0x56A2B6279A0E09E1ull },
+	{ 1, 0, 0, 1, 1, 0, 0x6008507407348BF5ull },
+	{ 1, 0, 0, 1, 1, 1, 0x6008507407348BF5ull },
+	{ 1, 0, 0, 1, 2, 0, 0xFCF76691D2230CF1ull },
+	{ 1, 0, 0, 1, 2, 1, 0xFCF76691D2230CF1ull },
+	{ 1, 1, 0, 0, 0, 0, 0x403DF5ACAF03BE6Dull },
+	{ 1, 1, 0, 0, 0, 1, 0x403DF5ACAF03BE6Dull },
+	{ 1, 1, 0, 0, 1, 0, 0xDBEC44893870475Dull },
+	{ 1, 1, 0, 0, 1, 1, 0xDBEC44893870475Dull },
+	{ 1, 1, 0, 0, 2, 0, 0x42ED60897F072BBDull },
+	{ 1, 1, 0, 0, 2, 1, 0x42ED60897F072BBDull },
+	{ 1, 1, 0, 1, 0, 0, 0xEE1DFC475FD5A25Cull },
+	{ 1, 1, 0, 1, 0, 1, 0xEE1DFC475FD5A25Cull },
+	{ 1, 1, 0, 1, 1, 0, 0x7CCBFDD7B40E2318ull },
+	{ 1, 1, 0, 1, 1, 1, 0x7CCBFDD7B40E2318ull },
+	{ 1, 1, 0, 1, 2, 0, 0xFCA64E93B6103789ull },
+	{ 1, 1, 0, 1, 2, 1, 0xFCA64E93B6103789ull },
+	{ 2, 0, 0, 0, 0, 0, 0x54B195E2CDA1A285ull },
+	{ 2, 0, 0, 0, 0, 1, 0x54B195E2CDA1A285ull },
+	{ 2, 0, 0, 0, 1, 0, 0x9BC16CD2E062AFE5ull },
+	{ 2, 0, 0, 0, 1, 1, 0x9BC16CD2E062AFE5ull },
+	{ 2, 0, 0, 0, 2, 0, 0xB373340D91410925ull },
+	{ 2, 0, 0, 0, 2, 1, 0xB373340D91410925ull },
+	{ 2, 0, 0, 1, 0, 0, 0x56A2B6279A0E09E1ull },
+	{ 2, 0, 0, 1, 0, 1, 0x56A2B6279A0E09E1ull },
+	{ 2, 0, 0, 1, 1, 0, 0x6008507407348BF5ull },
+	{ 2, 0, 0, 1, 1, 1, 0x6008507407348BF5ull },
+	{ 2, 0, 0, 1, 2, 0, 0xFCF76691D2230CF1ull },
+	{ 2, 0, 0, 1, 2, 1, 0xFCF76691D2230CF1ull },
+	{ 2, 1, 0, 0, 0, 0, 0x403DF5ACAF03BE6Dull },
+	{ 2, 1, 0, 0, 0, 1, 0x403DF5ACAF03BE6Dull },
+	{ 2, 1, 0, 0, 1, 0, 0xDBEC44893870475Dull },
+	{ 2, 1, 0, 0, 1, 1, 0xDBEC44893870475Dull },
+	{ 2, 1, 0, 0, 2, 0, 0x42ED60897F072BBDull },
+	{ 2, 1, 0, 0, 2, 1, 0x42ED60897F072BBDull },
+	{ 2, 1, 0, 1, 0, 0, 0xEE1DFC475FD5A25Cull },
+	{ 2, 1, 0, 1, 0, 1, 0xEE1DFC475FD5A25Cull },
+	{ 2, 1, 0, 1, 1, 0, 0x7CCBFDD7B40E2318ull },
+	{ 2, 1, 0, 1, 1, 1, 0x7CCBFDD7B40E2318ull },
+	{ 2, 1, 0, 1, 2, 0, 0xFCA64E93B6103789ull },
+	{ 2, 1, 0, 1, 2, 1, 0xFCA64E93B6103789ull },
+};
+
+const size_t GoldenSignalCount = sizeof(GoldenSignals) / sizeof(GoldenSignals[0]);
@@ -0,0 +1,128 @@
+/*
+NES-CVBS
+Copyright (c) 2023 Persune
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// hardware performance counters around the benchmark stages, through perf_event_open on Linux
+
+#include <cstdint>
+#include <cstring>
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+enum PerfCounter {
+	perf_cycles,
+	perf_instructions,
+	perf_l1d_misses,
+	perf_llc_misses,
+	perf_branch_misses,
+	perf_counter_count
+};
+
+const char* const PerfCounterNames[perf_counter_count] = {
+	"cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses"
+};
+
+// counter totals of one measurement, -1 where a counter isn't available
+struct PerfSample {
+	double counters[perf_counter_count];
+};
+
+class PerfCounters
+{
+	int CounterFiles[perf_counter_count];
+
+public:
+	PerfCounters() {
+		for (int& file : CounterFiles) file = -1;
+#ifdef __linux__
+		const struct { uint32_t type; uint64_t config; } events[perf_counter_count] = {
+			{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+			{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+			{ PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+			{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+			{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+		};
+		for (int counter = 0; counter < perf_counter_count; counter++) {
+			perf_event_attr attributes;
+			memset(&attributes, 0, sizeof(attributes));
+			attributes.size = sizeof(attributes);
+			attributes.type = events[counter].type;
+			attributes.config = events[counter].config;
+			attributes.disabled = 1;
+			attributes.exclude_kernel = 1;
+			attributes.exclude_hv = 1;
+			// FilterFrame() spawns its worker threads after the counters are opened
+			attributes.inherit = 1;
+			attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+			CounterFiles[counter] = int(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+		}
+#endif
+	}
+
+	~PerfCounters() {
+#ifdef __linux__
+		for (int file : CounterFiles)
+			if (file >= 0) close(file);
+#endif
+	}
+
+	PerfCounters(const PerfCounters&) = delete;
+	PerfCounters& operator=(const PerfCounters&) = delete;
+
+	bool Available() const {
+		for (int file : CounterFiles)
+			if (file >= 0) return true;
+		return false;
+	}
+
+	void Start() {
+#ifdef __linux__
+		for (int file : CounterFiles) {
+			if (file < 0) continue;
+			ioctl(file, PERF_EVENT_IOC_RESET, 0);
+			ioctl(file, PERF_EVENT_IOC_ENABLE, 0);
+		}
+#endif
+	}
+
+	PerfSample Stop() {
+		PerfSample sample;
+		for (double& value : sample.counters) value = -1.0;
+#ifdef __linux__
+		for (int counter = 0; counter < perf_counter_count; counter++) {
+			int file = CounterFiles[counter];
+			if (file < 0) continue;
+			ioctl(file, PERF_EVENT_IOC_DISABLE, 0);
+			// value, time enabled, time running. scale up if the counter was multiplexed
+			uint64_t values[3] = {};
+			if (read(file, values, sizeof(values)) != ssize_t(sizeof(values)) || !values[2]) continue;
+			sample.counters[counter] = double(values[0]) * (double(values[1]) / double(values[2]));
+		}
+#endif
+		return sample;
+	}
+};
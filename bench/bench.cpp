@@ -0,0 +1,534 @@
+/*
+NES-CVBS
+Copyright (c) 2023 Persune
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// NES-CVBS-Bench: times each filter stage over a matrix of filter settings
+// usage: NES-CVBS-Bench [--iterations n] [--repeats n] [--threads 1,2,4] [--corpus dir] [--output file.json] [--perf]
+//        NES-CVBS-Bench --verify		checks every filter path against the golden signal hashes
+//        NES-CVBS-Bench --generate-golden	prints the golden signal hash table from the reference path
+
+#include "bench.h"
+
+// synthetic frames standing in for typical PPU output
+static std::vector<std::vector<uint16_t>> BuildCorpus(int width, int height)
+{
+	std::vector<std::vector<uint16_t>> corpus;
+	size_t frame_size = size_t(width) * height;
+
+	// every 9-bit PPU pixel, in 8x8 blocks
+	std::vector<uint16_t> palette(frame_size);
+	for (int y = 0; y < height; y++)
+		for (int x = 0; x < width; x++)
+			palette[size_t(y) * width + x] = uint16_t((((y / 8) * (width / 8)) + (x / 8)) % 512);
+	corpus.push_back(palette);
+
+	// a side-scroller: sky, a tiled ground, some sprites and a black status bar
+	std::vector<uint16_t> game(frame_size);
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			uint16_t pixel = 0x21;
+			if (y < 32) pixel = ((x / 8 + y / 8) % 5 == 0 && (y & 7) < 6) ? 0x30 : 0x0F;
+			else if (y >= height - 48) pixel = ((x & 15) < 2 || (y & 15) < 2) ? 0x07 : (((x ^ y) & 4) ? 0x17 : 0x27);
+			else if (y >= height - 80 && (x % 64) < 32) pixel = ((x & 7) == 0 || (y & 7) == 0) ? 0x0A : 0x1A;
+			// 16x16 sprites
+			if (y >= height - 96 && y < height - 80 && ((x / 16) % 5) == 2)
+				pixel = ((x + y) & 3) ? 0x16 : 0x36;
+			game[size_t(y) * width + x] = pixel;
+		}
+	}
+	corpus.push_back(game);
+
+	// worst case for any content dependent path
+	std::vector<uint16_t> noise(frame_size);
+	uint32_t seed = 0x4E455321;
+	for (auto& pixel : noise) {
+		seed = seed * 1664525 + 1013904223;
+		pixel = uint16_t(seed >> 23);
+	}
+	corpus.push_back(noise);
+
+	// blank screens between scenes
+	corpus.push_back(std::vector<uint16_t>(frame_size, 0x0F));
+
+	return corpus;
+}
+
+// frames of the golden signal corpus
+static std::vector<uint16_t> BuildGoldenFrame(int frame_id, int width, int height)
+{
+	std::vector<uint16_t> frame(size_t(width) * height);
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			uint16_t pixel;
+			if (frame_id == golden_all_colors)
+				// every 9-bit pixel, in runs of 3 dots so each color lands on every dot phase
+				pixel = uint16_t(((y * width) + x) / 3 % 512);
+			else
+				// emphasis bars: each of the 8 emphasis combinations over all 64 colors
+				pixel = uint16_t((((x * 8) / width) << 6) | ((y * 64) / height));
+			frame[size_t(y) * width + x] = pixel;
+		}
+	}
+	return frame;
+}
+
+// FNV-1a over the signal field, as little-endian bytes
+static uint64_t HashSignal(const NES_CVBS& filter)
+{
+	uint64_t hash = 0xCBF29CE484222325;
+	size_t samples = size_t(filter.SignalBufferWidth) * filter.SignalBufferHeight;
+	for (size_t i = 0; i < samples; i++) {
+		uint16_t sample = filter.SignalFieldBuffer[i];
+		hash = (hash ^ (sample & 0xFF)) * 0x100000001B3;
+		hash = (hash ^ (sample >> 8)) * 0x100000001B3;
+	}
+	return hash;
+}
+
+// renders the golden corpus through the reference path (single thread, whole field) and through every
+// other path, which must produce the same signal and the same decoded output.
+// with generate set, prints the reference hashes as a GoldenSignals.h table instead of checking them
+static int RunGolden(bool generate)
+{
+	int failures = 0, checks = 0;
+	size_t golden_index = 0;
+	const int thread_counts[] = { 2, 3, 4, 7 };
+
+	if (generate) printf("const GoldenSignal GoldenSignals[] = {\n");
+
+	for (int ppu_type = 0; ppu_type < 3; ppu_type++) {
+		for (int sync_enable = 0; sync_enable < 2; sync_enable++) {
+			for (int full_frame_input = 0; full_frame_input < (ppu_type == 0 ? 2 : 1); full_frame_input++) {
+				NES_CVBS reference(ppu_type, 0, sync_enable, full_frame_input, 1);
+				int input_width = full_frame_input ? 283 : 256;
+				int input_height = full_frame_input ? 242 : 240;
+				size_t output_size = size_t(reference.OutputBufferWidth) * reference.OutputBufferHeight;
+				std::vector<uint32_t> reference_output(output_size), output(output_size);
+
+				// every field of this mode is dumped, then read back and decoded with DecodeSignal()
+				std::string dump_path = (std::filesystem::temp_directory_path() / "NES-CVBS-Bench-verify.dump").string();
+				SignalDumpWriter dump_writer;
+				bool dumping = !generate && dump_writer.Open(dump_path.c_str(), reference);
+				std::vector<std::vector<uint32_t>> dumped_outputs;
+
+				for (int frame_id = 0; frame_id < golden_frame_count; frame_id++) {
+					auto frame = BuildGoldenFrame(frame_id, input_width, input_height);
+					for (int dot_phase = 0; dot_phase < 3; dot_phase++) {
+						for (int skip_dot = 0; skip_dot < 2; skip_dot++) {
+							reference.FilterFrame(frame.data(), reference_output.data(), dot_phase, skip_dot);
+							uint64_t reference_hash = HashSignal(reference);
+
+							auto report = [&](const char* path, bool passed) {
+								checks++;
+								if (passed) return;
+								failures++;
+								fprintf(stderr, "mismatch: %s, ppu %d, sync %d, full frame %d, frame %d, dot phase %d, skip dot %d\n",
+									path, ppu_type, sync_enable, full_frame_input, frame_id, dot_phase, skip_dot);
+							};
+
+							if (generate) {
+								printf("\t{ %d, %d, %d, %d, %d, %d, 0x%016llXull },\n", ppu_type, sync_enable, full_frame_input,
+									frame_id, dot_phase, skip_dot, (unsigned long long)reference_hash);
+								continue;
+							}
+
+							if (dumping) {
+								dumping = dump_writer.WriteField(reference, dot_phase, skip_dot);
+								dumped_outputs.push_back(reference_output);
+							}
+
+							const GoldenSignal* golden = golden_index < GoldenSignalCount ? &GoldenSignals[golden_index++] : nullptr;
+							report("reference", golden != nullptr && golden->ppu_type == ppu_type && golden->sync_enable == sync_enable &&
+								golden->full_frame_input == full_frame_input && golden->frame_id == frame_id &&
+								golden->dot_phase == dot_phase && golden->skip_dot == skip_dot && golden->hash == reference_hash);
+
+							// threaded FilterFrame()
+							for (int thread_count : thread_counts) {
+								NES_CVBS threaded(ppu_type, 0, sync_enable, full_frame_input, thread_count);
+								std::fill(output.begin(), output.end(), 0);
+								threaded.FilterFrame(frame.data(), output.data(), dot_phase, skip_dot);
+								report("threaded", HashSignal(threaded) == reference_hash && output == reference_output);
+							}
+
+							// the field covered by FilterRegion() tiles
+							NES_CVBS tiled(ppu_type, 0, sync_enable, full_frame_input, 2);
+							std::fill(output.begin(), output.end(), 0);
+							int tile_width = (tiled.FieldBufferWidth + 2) / 3, tile_height = (tiled.FieldBufferHeight + 3) / 4;
+							for (int y = 0; y < tiled.FieldBufferHeight; y += tile_height)
+								for (int x = 0; x < tiled.FieldBufferWidth; x += tile_width)
+									tiled.FilterRegion(frame.data(), output.data(), dot_phase, skip_dot, x, y, tile_width, tile_height);
+							report("region", HashSignal(tiled) == reference_hash && output == reference_output);
+
+							// yuv420 regions at odd rows and heights, apart from each other, over a field left from another frame.
+							// the row pairs they're widened to for the shared chroma have to come from this frame too
+							size_t yuv_width = reference.OutputBufferWidth, chroma_width = (yuv_width + 1) / 2;
+							size_t luma_size = yuv_width * reference.OutputBufferHeight;
+							size_t chroma_size = chroma_width * ((reference.OutputBufferHeight + 1) / 2);
+							std::vector<uint8_t> reference_yuv(luma_size + (chroma_size * 2)), yuv(reference_yuv.size());
+							reference.FilterFrame(frame.data(), reference_yuv.data(), yuv420_planar, dot_phase, skip_dot);
+							NES_CVBS tiled_yuv(ppu_type, 0, sync_enable, full_frame_input, 1);
+							auto other_frame = BuildGoldenFrame((frame_id + 1) % golden_frame_count, input_width, input_height);
+							tiled_yuv.FilterFrame(other_frame.data(), yuv.data(), yuv420_planar, dot_phase, skip_dot);
+							bool yuv_match = true;
+							for (int y = 7; y + 7 <= tiled_yuv.FieldBufferHeight; y += 14) {
+								for (int x = 0; x < tiled_yuv.FieldBufferWidth; x += tile_width)
+									tiled_yuv.FilterRegion(frame.data(), yuv.data(), yuv420_planar, dot_phase, skip_dot, x, y, tile_width, 7);
+								// rows y - 1 to y + 7 after widening, and the chroma rows they share
+								for (size_t row = y - 1; row < size_t(y + 7); row++)
+									yuv_match &= std::equal(&yuv[row * yuv_width], &yuv[(row + 1) * yuv_width], &reference_yuv[row * yuv_width]);
+								for (size_t row = (y - 1) / 2; row < size_t(y + 7) / 2; row++)
+									for (size_t plane = luma_size; plane < yuv.size(); plane += chroma_size)
+										yuv_match &= std::equal(&yuv[plane + (row * chroma_width)], &yuv[plane + ((row + 1) * chroma_width)],
+											&reference_yuv[plane + (row * chroma_width)]);
+							}
+							report("region yuv420", yuv_match);
+
+							if (!sync_enable) continue;
+
+							// burst lock decodes as dot_phase does, but for line 0 of skipped-dot NTSC fields.
+							// the dot is skipped after that line's burst, so it relocks to the next burst at line 1
+							size_t line_pixels = size_t(reference.OutputBufferWidth) * (reference.OutputBufferHeight / reference.FieldBufferHeight);
+							size_t compare_start = (skip_dot && ppu_type == 0) ? line_pixels : 0;
+							std::vector<uint32_t> locked_output(output_size);
+							NES_CVBS locked(ppu_type, 0, sync_enable, full_frame_input, 1);
+							locked.SetBurstLock(true);
+							locked.FilterFrame(frame.data(), locked_output.data(), dot_phase, skip_dot);
+							report("burst lock", std::equal(locked_output.begin() + compare_start, locked_output.end(), reference_output.begin() + compare_start));
+
+							NES_CVBS locked_threaded(ppu_type, 0, sync_enable, full_frame_input, 4);
+							locked_threaded.SetBurstLock(true);
+							std::fill(output.begin(), output.end(), 0);
+							locked_threaded.FilterFrame(frame.data(), output.data(), dot_phase, skip_dot);
+							report("burst lock threaded", output == locked_output);
+
+							// right to left on a new filter, so the tiles right of the burst come first and have to encode it themselves
+							NES_CVBS locked_tiled(ppu_type, 0, sync_enable, full_frame_input, 2);
+							locked_tiled.SetBurstLock(true);
+							std::fill(output.begin(), output.end(), 0);
+							for (int y = 0; y < locked_tiled.FieldBufferHeight; y += tile_height)
+								for (int x = (locked_tiled.FieldBufferWidth - 1) / tile_width * tile_width; x >= 0; x -= tile_width)
+									locked_tiled.FilterRegion(frame.data(), output.data(), dot_phase, skip_dot, x, y, tile_width, tile_height);
+							report("burst lock region", output == locked_output);
+
+							// a capture-like field: the reference signal delayed by 0.4 samples, with a few mV of noise.
+							// the PLL has to follow the delay as 0.4 of a phase earlier, the same on every line
+							if (frame_id != 0 || dot_phase != 0 || skip_dot) continue;
+							size_t samples = size_t(reference.SignalBufferWidth) * reference.SignalBufferHeight;
+							std::vector<uint16_t> captured(samples);
+							uint32_t seed = 0x4E455321;
+							for (size_t i = 0; i < samples; i++) {
+								float previous = float(reference.SignalFieldBuffer[i > 0 ? i - 1 : 0]);
+								seed = seed * 1664525 + 1013904223;
+								float noise = float(int(seed >> 28) - 8);
+								captured[i] = uint16_t(std::lround(float(reference.SignalFieldBuffer[i]) * 0.6f + previous * 0.4f + noise));
+							}
+							NES_CVBS tracker(ppu_type, 0, sync_enable, full_frame_input, 1);
+							tracker.DetectLinePhase(reference.SignalFieldBuffer);
+							std::vector<float> clean_phase(reference.SignalBufferHeight);
+							for (int line = 0; line < reference.SignalBufferHeight; line++)
+								clean_phase[line] = NES_CVBS_Bench::LinePhase(tracker, line);
+							tracker.DetectLinePhase(captured.data());
+							float delay_min = 12.0f, delay_max = -12.0f;
+							// lines with a burst, from line 32 on, where the PLL has settled after the vertical sync
+							for (int line = 32; line < reference.SignalBufferHeight; line++) {
+								if (!NES_CVBS_Bench::HasBurst(reference, reference.SignalFieldBuffer, line)) continue;
+								float delay = std::remainder(NES_CVBS_Bench::LinePhase(tracker, line) - clean_phase[line], 12.0f);
+								delay_min = std::min(delay_min, delay);
+								delay_max = std::max(delay_max, delay);
+							}
+							// no burst lines leave min above max
+							report("burst tracking", delay_min > -0.5f && delay_max < -0.3f);
+						}
+					}
+				}
+				if (generate) continue;
+
+				// the dumped fields decode as FilterFrame() did, single threaded and threaded. with sync, the phases come from
+				// the burst, which line 0 of skipped-dot NTSC fields skips the dot after, so that line is left out there
+				dump_writer.Close();
+				SignalDumpReader dump_reader;
+				bool dump_read = dumping && dump_reader.Open(dump_path.c_str(), reference) && dump_reader.FieldCount() == dumped_outputs.size();
+				if (!dump_read) fprintf(stderr, "mismatch: signal dump, could not write and read back %s\n", dump_path.c_str());
+				size_t line_pixels = size_t(reference.OutputBufferWidth) * (reference.OutputBufferHeight / reference.FieldBufferHeight);
+				for (int thread_count : { 1, 4 }) {
+					NES_CVBS decoder(ppu_type, 0, sync_enable, full_frame_input, thread_count);
+					bool dump_match = dump_read;
+					for (uint32_t field_index = 0; dump_match && field_index < dump_reader.FieldCount(); field_index++) {
+						SignalDumpField field_info;
+						const uint16_t* field = dump_reader.Field(field_index, &field_info);
+						std::fill(output.begin(), output.end(), 0);
+						decoder.DecodeSignal(field, output.data(), field_info.dot_phase, field_info.skip_dot);
+						size_t compare_start = (sync_enable && field_info.skip_dot && ppu_type == 0) ? line_pixels : 0;
+						const auto& expected = dumped_outputs[field_index];
+						dump_match = std::equal(output.begin() + compare_start, output.end(), expected.begin() + compare_start);
+						if (!dump_match)
+							fprintf(stderr, "mismatch: signal dump, ppu %d, sync %d, full frame %d, field %u, dot phase %d, skip dot %u, threads %d\n",
+								ppu_type, sync_enable, full_frame_input, field_index, field_info.dot_phase, field_info.skip_dot, thread_count);
+					}
+					checks++;
+					if (!dump_match) failures++;
+				}
+				dump_reader.Close();
+				std::filesystem::remove(dump_path);
+			}
+		}
+	}
+
+	if (generate) {
+		printf("};\n");
+		return 0;
+	}
+	if (golden_index != GoldenSignalCount) {
+		fprintf(stderr, "golden table has %zu entries, the corpus rendered %zu\n", GoldenSignalCount, golden_index);
+		failures++;
+	}
+	fprintf(stderr, "%d of %d golden signal checks passed\n", checks - failures, checks);
+	return failures ? 1 : 0;
+}
+
+// raw frames from disk, only the ones matching the input size are used
+static void LoadCorpus(const std::string& path, size_t frame_size, std::vector<std::vector<uint16_t>>& corpus)
+{
+	std::error_code error;
+	for (const auto& entry : std::filesystem::directory_iterator(path, error)) {
+		if (!entry.is_regular_file() || entry.file_size() != frame_size * sizeof(uint16_t)) continue;
+		std::ifstream file(entry.path(), std::ios::binary);
+		std::vector<uint8_t> bytes(frame_size * sizeof(uint16_t));
+		file.read((char*)bytes.data(), bytes.size());
+		std::vector<uint16_t> frame(frame_size);
+		for (size_t i = 0; i < frame_size; i++)
+			frame[i] = uint16_t(bytes[i * 2] | (bytes[i * 2 + 1] << 8)) & 0x1FF;
+		corpus.push_back(std::move(frame));
+	}
+	if (error) std::cerr << "could not read corpus " << path << ": " << error.message() << std::endl;
+}
+
+// runs frame_function(frame_index) for each iteration of each repeat
+template <typename FrameFunction>
+static BenchTiming TimeFrames(const BenchSettings& settings, PerfCounters* perf_counters, FrameFunction frame_function)
+{
+	BenchTiming timing;
+	// warm up caches and the allocator
+	for (int i = 0; i < 3; i++) frame_function(i);
+
+	if (perf_counters != nullptr) perf_counters->Start();
+	for (int repeat = 0; repeat < settings.repeats; repeat++) {
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < settings.iterations; i++)
+			frame_function(i);
+		auto end = std::chrono::steady_clock::now();
+		timing.repeat_times.push_back(std::chrono::duration<double, std::nano>(end - start).count() / settings.iterations);
+	}
+	if (perf_counters != nullptr) {
+		timing.has_perf = true;
+		timing.perf_per_frame = perf_counters->Stop();
+		for (double& value : timing.perf_per_frame.counters)
+			if (value >= 0.0) value /= double(settings.iterations) * settings.repeats;
+	}
+	return timing;
+}
+
+static BenchResult MakeResult(int ppu_type, bool sync_enable, bool full_frame_input, int thread_count, const char* stage, BenchTiming timing, size_t bytes_per_frame, size_t dots_per_frame)
+{
+	std::sort(timing.repeat_times.begin(), timing.repeat_times.end());
+	return { ppu_type, sync_enable, full_frame_input, thread_count, stage,
+		timing.repeat_times[timing.repeat_times.size() / 2], timing.repeat_times.front(), bytes_per_frame,
+		dots_per_frame, timing.has_perf, timing.perf_per_frame };
+}
+
+// counters per frame, IPC and misses per dot
+static void WritePerf(FILE* output, const BenchResult& result)
+{
+	const double* counters = result.perf_per_frame.counters;
+	fprintf(output, ", \"perf\": { ");
+	for (int counter = 0; counter < perf_counter_count; counter++) {
+		if (counters[counter] < 0.0) fprintf(output, "\"%s_per_frame\": null, ", PerfCounterNames[counter]);
+		else fprintf(output, "\"%s_per_frame\": %.0f, ", PerfCounterNames[counter], counters[counter]);
+	}
+
+	if (counters[perf_cycles] > 0.0 && counters[perf_instructions] >= 0.0)
+		fprintf(output, "\"ipc\": %.3f", counters[perf_instructions] / counters[perf_cycles]);
+	else
+		fprintf(output, "\"ipc\": null");
+
+	for (int counter : { perf_cycles, perf_l1d_misses, perf_llc_misses, perf_branch_misses }) {
+		if (counters[counter] < 0.0) fprintf(output, ", \"%s_per_dot\": null", PerfCounterNames[counter]);
+		else fprintf(output, ", \"%s_per_dot\": %.4f", PerfCounterNames[counter], counters[counter] / double(result.dots_per_frame));
+	}
+	fprintf(output, " }");
+}
+
+static void WriteResults(FILE* output, const BenchSettings& settings, const std::vector<BenchResult>& results)
+{
+	fprintf(output, "{\n");
+	fprintf(output, "\t\"benchmark\": \"NES-CVBS-Bench\",\n");
+	fprintf(output, "\t\"hardware_concurrency\": %u,\n", std::thread::hardware_concurrency());
+	fprintf(output, "\t\"iterations\": %d,\n", settings.iterations);
+	fprintf(output, "\t\"repeats\": %d,\n", settings.repeats);
+	fprintf(output, "\t\"results\": [\n");
+	for (size_t i = 0; i < results.size(); i++) {
+		const BenchResult& result = results[i];
+		double seconds_per_frame = result.ns_per_frame * 1e-9;
+		fprintf(output, "\t\t{ \"ppu_type\": %d, \"sync\": %s, \"full_frame_input\": %s, \"threads\": %d, \"stage\": \"%s\", "
+			"\"ns_per_frame\": %.0f, \"ns_per_frame_min\": %.0f, \"frames_per_s\": %.2f, \"bytes_per_frame\": %zu, \"mb_per_s\": %.2f",
+			result.ppu_type, result.sync_enable ? "true" : "false", result.full_frame_input ? "true" : "false",
+			result.thread_count, result.stage, result.ns_per_frame, result.ns_per_frame_min,
+			1.0 / seconds_per_frame, result.bytes_per_frame, (result.bytes_per_frame / 1e6) / seconds_per_frame);
+		if (result.has_perf) WritePerf(output, result);
+		fprintf(output, " }%s\n", (i + 1 < results.size()) ? "," : "");
+	}
+	fprintf(output, "\t]\n}\n");
+}
+
+int main(int argc, char* argv[])
+{
+	BenchSettings settings;
+
+	for (int i = 1; i < argc; i++) {
+		std::string argument = argv[i];
+		bool has_value = i + 1 < argc;
+		if (argument == "--iterations" && has_value) settings.iterations = std::max(1, atoi(argv[++i]));
+		else if (argument == "--repeats" && has_value) settings.repeats = std::max(1, atoi(argv[++i]));
+		else if (argument == "--corpus" && has_value) settings.corpus_path = argv[++i];
+		else if (argument == "--output" && has_value) settings.output_path = argv[++i];
+		else if (argument == "--perf") settings.perf = true;
+		else if (argument == "--verify") return RunGolden(false);
+		else if (argument == "--generate-golden") return RunGolden(true);
+		else if (argument == "--threads" && has_value) {
+			std::string list = argv[++i];
+			for (size_t start = 0; start < list.size();) {
+				size_t end = list.find(',', start);
+				if (end == std::string::npos) end = list.size();
+				int thread_count = atoi(list.substr(start, end - start).c_str());
+				if (thread_count > 0) settings.thread_counts.push_back(thread_count);
+				start = end + 1;
+			}
+		}
+		else {
+			std::cerr << "usage: " << argv[0] << " [--iterations n] [--repeats n] [--threads 1,2,4] [--corpus dir] [--output file.json] [--perf] | --verify | --generate-golden" << std::endl;
+			return 1;
+		}
+	}
+
+	if (settings.thread_counts.empty()) {
+		int hardware_threads = std::max(1, int(std::thread::hardware_concurrency()));
+		for (int thread_count = 1; thread_count < hardware_threads; thread_count *= 2)
+			settings.thread_counts.push_back(thread_count);
+		settings.thread_counts.push_back(hardware_threads);
+	}
+
+	PerfCounters* perf_counters = nullptr;
+	if (settings.perf) {
+		perf_counters = new PerfCounters();
+		if (!perf_counters->Available()) {
+			std::cerr << "hardware performance counters are not available, continuing without them" << std::endl;
+			delete perf_counters;
+			perf_counters = nullptr;
+		}
+	}
+
+	std::vector<BenchResult> results;
+
+	for (int ppu_type = 0; ppu_type < 3; ppu_type++) {
+		for (int sync_enable = 0; sync_enable < 2; sync_enable++) {
+			// full frame input is only available in NTSC
+			for (int full_frame_input = 0; full_frame_input < (ppu_type == 0 ? 2 : 1); full_frame_input++) {
+				NES_CVBS filter(ppu_type, 0, sync_enable, full_frame_input, 1);
+
+				// input dimensions, see EmplaceField()
+				int input_width = full_frame_input ? 283 : 256;
+				int input_height = full_frame_input ? 242 : 240;
+				auto corpus = BuildCorpus(input_width, input_height);
+				if (!settings.corpus_path.empty())
+					LoadCorpus(settings.corpus_path, size_t(input_width) * input_height, corpus);
+
+				std::vector<uint32_t> rgb_buffer(size_t(filter.OutputBufferWidth) * filter.OutputBufferHeight);
+				size_t input_bytes = size_t(input_width) * input_height * sizeof(uint16_t);
+				size_t signal_bytes = size_t(filter.SignalBufferWidth) * filter.SignalBufferHeight * sizeof(uint16_t);
+				size_t dots = size_t(filter.FieldBufferWidth) * filter.FieldBufferHeight;
+
+				results.push_back(MakeResult(ppu_type, sync_enable, full_frame_input, 1, "emplace",
+					TimeFrames(settings, perf_counters, [&](int i) {
+						NES_CVBS_Bench::Emplace(filter, corpus[i % corpus.size()].data());
+					}), input_bytes, dots));
+
+				results.push_back(MakeResult(ppu_type, sync_enable, full_frame_input, 1, "encode",
+					TimeFrames(settings, perf_counters, [&](int i) {
+						NES_CVBS_Bench::Encode(filter, i % 3, i & 1);
+					}), signal_bytes, dots));
+
+				results.push_back(MakeResult(ppu_type, sync_enable, full_frame_input, 1, "decode",
+					TimeFrames(settings, perf_counters, [&](int) {
+						NES_CVBS_Bench::Decode(filter, rgb_buffer.data());
+					}), signal_bytes, dots));
+
+				// the 16-bit big-endian signal images the demo writes
+				std::vector<uint8_t> export_buffer(signal_bytes);
+				results.push_back(MakeResult(ppu_type, sync_enable, full_frame_input, 1, "export_signal",
+					TimeFrames(settings, perf_counters, [&](int) {
+						filter.ExportSignalField(export_buffer.data());
+					}), signal_bytes, dots));
+
+				// slicing a continuous stream of encoded fields back into fields, without decoding them
+				if (sync_enable) {
+					size_t field_samples = size_t(filter.SignalBufferWidth) * filter.SignalBufferHeight;
+					std::vector<uint16_t> stream;
+					for (int field = 0; field < 3; field++) {
+						filter.FilterFrame(corpus[field % corpus.size()].data(), rgb_buffer.data(), field, false);
+						stream.insert(stream.end(), filter.SignalFieldBuffer, filter.SignalFieldBuffer + field_samples);
+					}
+					SyncSeparator separator(filter);
+					results.push_back(MakeResult(ppu_type, sync_enable, full_frame_input, 1, "sync_separate",
+						TimeFrames(settings, perf_counters, [&](int i) {
+							const uint16_t* samples = &stream[(i % 3) * field_samples];
+							for (size_t pushed = 0; pushed < field_samples;) {
+								pushed += separator.Push(samples + pushed, field_samples - pushed);
+								if (separator.FieldReady()) separator.ReleaseField();
+							}
+						}), signal_bytes, dots));
+				}
+
+				for (int thread_count : settings.thread_counts) {
+					NES_CVBS threaded_filter(ppu_type, 0, sync_enable, full_frame_input, thread_count);
+					results.push_back(MakeResult(ppu_type, sync_enable, full_frame_input, thread_count, "filter_frame",
+						TimeFrames(settings, perf_counters, [&](int i) {
+							threaded_filter.FilterFrame(corpus[i % corpus.size()].data(), rgb_buffer.data(), i % 3, i & 1);
+						}), signal_bytes, dots));
+				}
+			}
+		}
+	}
+
+	FILE* output = stdout;
+	if (!settings.output_path.empty()) {
+		output = fopen(settings.output_path.c_str(), "w");
+		if (output == nullptr) {
+			std::cerr << "could not open " << settings.output_path << std::endl;
+			return 1;
+		}
+	}
+	WriteResults(output, settings, results);
+	if (output != stdout) fclose(output);
+	delete perf_counters;
+
+	return 0;
+}
@@ -0,0 +1,102 @@
+/*
+NES-CVBS
+Copyright (c) 2023 Persune
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <filesystem>
+#include <fstream>
+#include <algorithm>
+#include <iostream>
+#include "src/NES-CVBS.h"
+#include "src/SyncSeparator.h"
+#include "src/SignalDump.h"
+#include "PerfCounters.h"
+#include "GoldenSignals.h"
+
+// a single timed measurement, written out as one JSON object
+struct BenchResult {
+	int ppu_type;
+	bool sync_enable;
+	bool full_frame_input;
+	int thread_count;
+	const char* stage;
+	double ns_per_frame;		// median of all repeats
+	double ns_per_frame_min;	// best repeat
+	size_t bytes_per_frame;		// data the stage consumes or produces per frame
+	size_t dots_per_frame;		// PPU dots in the field
+	bool has_perf;
+	PerfSample perf_per_frame;	// hardware counters, averaged over every timed frame
+};
+
+// ns per frame of every repeat, and the hardware counters over all of them
+struct BenchTiming {
+	std::vector<double> repeat_times;
+	bool has_perf = false;
+	PerfSample perf_per_frame = {};
+};
+
+struct BenchSettings {
+	int iterations = 50;		// frames per repeat
+	int repeats = 5;
+	std::vector<int> thread_counts;
+	std::string corpus_path;	// directory of raw little-endian uint16_t PPU frames
+	std::string output_path;	// JSON output, stdout if empty
+	bool perf = false;			// read hardware performance counters around each stage
+};
+
+// drives the private filter stages of NES_CVBS directly
+class NES_CVBS_Bench
+{
+public:
+	static void Emplace(NES_CVBS& filter, const uint16_t* ppu_buffer) {
+		filter.PPURawFrameBuffer = ppu_buffer;
+		filter.EmplaceField(0, filter.FieldBufferHeight);
+	}
+
+	static void Encode(NES_CVBS& filter, int dot_phase, bool skip_dot) {
+		filter.EncodeField(dot_phase, 0, filter.FieldBufferHeight, skip_dot, 0, filter.FieldBufferWidth);
+	}
+
+	static void Decode(NES_CVBS& filter, uint32_t* rgb_buffer) {
+		filter.DecodeField<PixelWriterXRGB8888>(rgb_buffer, 0, filter.FieldBufferHeight, 0, filter.OutputBufferWidth);
+	}
+
+	// whether a scanline of a signal field carries a colorburst: a swing in the burst window up from below blank.
+	// the burst dips below the sync threshold on the NES, vertical sync lines are flat there
+	static bool HasBurst(const NES_CVBS& filter, const uint16_t* signal_field, int scanline) {
+		const uint16_t* burst = &signal_field[size_t(scanline) * filter.SignalBufferWidth + filter.DecoderBurstStart];
+		auto [low, high] = std::minmax_element(burst, burst + filter.DecoderBurstCos.size());
+		return *high > filter.GetSyncThreshold() && *high > *low;
+	}
+
+	// line phase the decoder uses for a scanline, with the fraction from the burst PLL
+	static float LinePhase(const NES_CVBS& filter, int scanline) {
+		return filter.SignalLinePhase[scanline] + filter.SignalLinePhaseOffset[scanline];
+	}
+};
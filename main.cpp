@@ -22,38 +22,384 @@ SOFTWARE.
 */
 
 // demo program, takes in an indexed .bmp
+// usage: NES-CVBS-Demo [--ppu 0-2] [--sync] [--full-frame] [--threads n] [--width n] [--input frames.raw] [--frames n]
+//                      (--y4m file | --rgb file)
+// streams the filtered frames to a file or a FIFO, or stdout with "-", e.g.
+//   NES-CVBS-Demo --input movie.raw --y4m - | ffmpeg -i - movie.mkv
+// or filters every raw PPU dump or indexed PNG/BMP matched by a directory or pattern into RGB PNGs:
+//   NES-CVBS-Demo --batch "frames/*.png" --output-dir out --threads 8
+// or writes a .pal of the composite colors, which later runs load instead to skip the filter:
+//   NES-CVBS-Demo --palette ntsc.pal [--batch "frames/*.png"]
+// --profile file runs on the voltages and timings of a PPUProfile text file, --save-profile file writes
+// the current one (e.g. --ppu 1 --save-profile 2c07.txt) as a starting point for new measurements
+// --table-cache dir keeps the generated filter tables in dir, so later runs with the same settings map them instead
 
 #include "main.h"
 
+// the loaded profile replaces the compiled-in one of the filter's PPU type
+static void ApplyProfile(const DemoSettings& settings, NES_CVBS& nes_filter)
+{
+	if (settings.profile_path != nullptr)
+		nes_filter.SetProfile(settings.profile.GetVoltages(), settings.profile.GetTimings());
+}
+
+// scrolling bars of all 64 colors, when there's no input
+static void DemoPattern(uint16_t* ppu_frame, int width, int height, long frame)
+{
+	for (int y = 0; y < height; y++)
+		for (int x = 0; x < width; x++)
+			ppu_frame[(y * width) + x] = uint16_t((((x + frame) / 4) & 0x0F) | (((y * 4) / height) << 4));
+}
+
+// streams filtered frames as YUV4MPEG2 (4:2:0, BT.601 limited range) or as raw bgr0 frames.
+// each frame is written in one call by a second thread, while the next one is filtered
+static int StreamFrames(const DemoSettings& settings)
+{
+	NES_CVBS nes_filter(settings.ppu_type, 0, settings.sync_enable, settings.full_frame_input, std::max(settings.thread_count, 1), settings.output_width);
+	ApplyProfile(settings, nes_filter);
+	if (settings.thread_count == 0)
+		nes_filter.SetAutoThreadCount(true);
+
+	bool y4m = settings.y4m_path != nullptr;
+	const char* output_path = y4m ? settings.y4m_path : settings.rgb_path;
+	FILE* output = stdout;
+	if (strcmp(output_path, "-") == 0) {
+#ifdef _WIN32
+		_setmode(_fileno(stdout), _O_BINARY);
+#endif
+	}
+	else if ((output = fopen(output_path, "wb")) == nullptr) {
+		std::cerr << "could not open " << output_path << std::endl;
+		return 1;
+	}
+
+	// see EmplaceField()
+	int input_width = settings.full_frame_input ? settings.profile.GetTimings().visible_width : 256;
+	int input_height = settings.full_frame_input ? settings.profile.GetTimings().visible_height : 240;
+	std::vector<uint16_t> ppu_frame(size_t(input_width) * input_height);
+
+	PPUTraceReader input;
+	if (settings.input_path != nullptr && !input.Open(settings.input_path, input_width, input_height)) {
+		std::cerr << "could not open " << settings.input_path << std::endl;
+		return 1;
+	}
+
+	// frame rate: NTSC master clock / 4 per dot, 341 x 262 dots less half a skipped dot per frame.
+	// PAL and Dendy master clock / 5 per dot, 341 x 312 dots
+	const char* frame_rate = settings.ppu_type == 0 ? "39375000:655171" : "3325214:66495";
+	uint16_t width = nes_filter.OutputBufferWidth, height = nes_filter.OutputBufferHeight;
+	PixelFormat pixel_format = y4m ? yuv420_planar : xrgb8888;
+	if (y4m)
+		fprintf(output, "YUV4MPEG2 W%u H%u F%s Ip A1:1 C420jpeg XCOLORRANGE=LIMITED\n", width, height, frame_rate);
+	else
+		std::cerr << "raw frames: -f rawvideo -pix_fmt bgr0 -s " << width << "x" << height << " -r " << frame_rate << std::endl;
+
+	// two frames, one being filtered while the other one is written. y4m frames are led by their header
+	const char frame_header[] = "FRAME\n";
+	size_t header_size = y4m ? strlen(frame_header) : 0;
+	size_t frame_size = header_size + PixelBufferSize(pixel_format, width, height);
+	std::vector<uint8_t> frame_buffers[2] = { std::vector<uint8_t>(frame_size), std::vector<uint8_t>(frame_size) };
+	for (auto& frame_buffer : frame_buffers)
+		memcpy(frame_buffer.data(), frame_header, header_size);
+
+	std::thread writer;
+	bool write_failed = false;
+	long frame = 0;
+	for (; settings.frames < 0 || frame < settings.frames; frame++) {
+		// input frames are filtered straight out of the mapping
+		const uint16_t* ppu_pixels = ppu_frame.data();
+		if (settings.input_path != nullptr) {
+			if ((ppu_pixels = input.Frame(size_t(frame))) == nullptr)
+				break;
+		}
+		else if (settings.frames < 0 && frame >= 600)
+			break;
+		else
+			DemoPattern(ppu_frame.data(), input_width, input_height, frame);
+
+		uint8_t* frame_buffer = frame_buffers[frame & 1].data();
+		nes_filter.FilterFrame(ppu_pixels, frame_buffer + header_size, pixel_format, int(frame % 3), frame & 1);
+
+		if (writer.joinable())
+			writer.join();
+		if (write_failed)
+			break;
+		writer = std::thread([&, frame_buffer] {
+			write_failed = fwrite(frame_buffer, 1, frame_size, output) != frame_size;
+		});
+	}
+	if (writer.joinable())
+		writer.join();
+
+	fflush(output);
+	if (output != stdout) fclose(output);
+	std::cerr << frame << " frames" << std::endl;
+	return write_failed ? 1 : 0;
+}
+
+static bool MatchesPattern(const char* name, const char* pattern)
+{
+	if (*pattern == '\0') return *name == '\0';
+	if (*pattern == '*') return MatchesPattern(name, pattern + 1) || (*name != '\0' && MatchesPattern(name + 1, pattern));
+	if (*name == '\0') return false;
+	return (*pattern == '?' || *pattern == *name) && MatchesPattern(name + 1, pattern + 1);
+}
+
+// every file in a directory, or the files matching a pattern in its last path component
+static std::vector<std::filesystem::path> CollectInputs(const char* batch_pattern)
+{
+	std::filesystem::path pattern = batch_pattern;
+	std::filesystem::path directory = pattern;
+	std::string name_pattern = "*";
+	std::error_code error;
+	if (!std::filesystem::is_directory(pattern, error)) {
+		directory = pattern.has_parent_path() ? pattern.parent_path() : std::filesystem::path(".");
+		name_pattern = pattern.filename().string();
+	}
+
+	std::vector<std::filesystem::path> inputs;
+	for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+		if (entry.is_regular_file() && MatchesPattern(entry.path().filename().string().c_str(), name_pattern.c_str()))
+			inputs.push_back(entry.path());
+	}
+	std::sort(inputs.begin(), inputs.end());
+	return inputs;
+}
+
+static bool IsImage(const std::filesystem::path& path)
+{
+	return path.extension() == ".png" || path.extension() == ".bmp";
+}
+
+// one frame of one input. PNG and BMP inputs are a single frame, anything else is a raw trace
+struct BatchItem {
+	size_t input;
+	size_t frame;
+};
+
+// filters every input on a pool of workers, each with its own single threaded filter, or only colors them
+// through a palette. raw traces are mapped up front and their frames split across the workers like any other item
+static int BatchFilter(const DemoSettings& settings, const PPUPalette* palette)
+{
+	auto inputs = CollectInputs(settings.batch_pattern);
+	if (inputs.empty()) {
+		std::cerr << "no inputs match " << settings.batch_pattern << std::endl;
+		return 1;
+	}
+	std::filesystem::create_directories(settings.output_directory);
+
+	int input_width = settings.full_frame_input ? settings.profile.GetTimings().visible_width : 256;
+	int input_height = settings.full_frame_input ? settings.profile.GetTimings().visible_height : 240;
+
+	std::atomic<size_t> next_item = 0, frames_filtered = 0, failures = 0;
+	std::vector<PPUTraceReader> traces(inputs.size());
+	std::vector<BatchItem> items;
+	for (size_t input = 0; input < inputs.size(); input++) {
+		if (IsImage(inputs[input]))
+			items.push_back({ input, 0 });
+		else if (traces[input].Open(inputs[input].string().c_str(), input_width, input_height)) {
+			for (size_t frame = 0; frame < traces[input].FrameCount(); frame++)
+				items.push_back({ input, frame });
+		}
+		else {
+			std::cerr << "could not load " << inputs[input].string() << std::endl;
+			failures++;
+		}
+	}
+
+	int worker_count = settings.thread_count > 0 ? settings.thread_count : std::max(1, int(std::thread::hardware_concurrency()));
+	worker_count = std::max(1, std::min(worker_count, int(items.size())));
+
+	auto worker = [&] {
+		std::unique_ptr<NES_CVBS> nes_filter;
+		uint16_t width = uint16_t(input_width), height = uint16_t(input_height);
+		if (palette == nullptr) {
+			nes_filter = std::make_unique<NES_CVBS>(settings.ppu_type, 0, settings.sync_enable, settings.full_frame_input, 1, settings.output_width);
+			ApplyProfile(settings, *nes_filter);
+			width = nes_filter->OutputBufferWidth;
+			height = nes_filter->OutputBufferHeight;
+		}
+		std::vector<uint32_t> rgb_frame(size_t(width) * height);
+		std::vector<unsigned char> rgb_bytes(rgb_frame.size() * 3);
+		std::vector<uint16_t> image(size_t(input_width) * input_height);
+		PPUFrameLoader loader;
+		lodepng::State png_state;
+		png_state.info_raw.colortype = LCT_RGB;
+		png_state.info_png.color.colortype = LCT_RGB;
+		png_state.encoder.auto_convert = 0;
+		apply_png_preset(png_state, settings.png_preset);
+		std::vector<unsigned char> png;
+
+		for (size_t index = next_item++; index < items.size(); index = next_item++) {
+			const BatchItem& item = items[index];
+			const PPUTraceReader& trace = traces[item.input];
+			const uint16_t* ppu_pixels = image.data();
+			if (!trace.FrameCount() && !loader.Load(inputs[item.input].string().c_str(), image.data(), input_width, input_height)) {
+				std::cerr << "could not load " << inputs[item.input].string() << std::endl;
+				failures++;
+				continue;
+			}
+			if (trace.FrameCount())
+				ppu_pixels = trace.Frame(item.frame);
+
+			if (palette != nullptr)
+				palette->Apply(ppu_pixels, rgb_frame.data(), rgb_frame.size());
+			else
+				nes_filter->FilterFrame(ppu_pixels, rgb_frame.data(), int(item.frame % 3), item.frame & 1);
+			for (size_t pixel = 0; pixel < rgb_frame.size(); pixel++) {
+				rgb_bytes[(pixel * 3) + 0] = uint8_t(rgb_frame[pixel] >> 16);
+				rgb_bytes[(pixel * 3) + 1] = uint8_t(rgb_frame[pixel] >> 8);
+				rgb_bytes[(pixel * 3) + 2] = uint8_t(rgb_frame[pixel]);
+			}
+
+			std::string name = inputs[item.input].stem().string();
+			if (trace.FrameCount() > 1) name += "_" + std::to_string(item.frame);
+			std::filesystem::path output_path = std::filesystem::path(settings.output_directory) / (name + ".png");
+			png.clear();
+			if (lodepng::encode(png, rgb_bytes, width, height, png_state) || lodepng::save_file(png, output_path.string())) {
+				std::cerr << "could not write " << output_path.string() << std::endl;
+				failures++;
+			}
+			frames_filtered++;
+		}
+	};
+
+	auto start = std::chrono::steady_clock::now();
+	std::vector<std::thread> workers;
+	for (int worker_number = 0; worker_number < worker_count; worker_number++)
+		workers.emplace_back(worker);
+	for (auto& thread : workers)
+		thread.join();
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::cerr << inputs.size() << " inputs, " << frames_filtered << " frames in " << seconds << " s on " << worker_count << " workers, "
+		<< (frames_filtered / seconds) << " frames/s" << std::endl;
+	return failures ? 1 : 0;
+}
+
+// a cached palette, or a new one from the composite model of the current settings, written to the cache
+static bool LoadPalette(const DemoSettings& settings, PPUPalette& palette)
+{
+	if (palette.Load(settings.palette_path)) {
+		std::cerr << "loaded " << palette.ColorCount() << " colors from " << settings.palette_path << std::endl;
+		return true;
+	}
+	NES_CVBS nes_filter(settings.ppu_type, 0, settings.sync_enable, settings.full_frame_input, 1, settings.output_width);
+	ApplyProfile(settings, nes_filter);
+	palette.Generate(nes_filter, settings.palette_emphasis);
+	if (!palette.Save(settings.palette_path)) {
+		std::cerr << "could not write " << settings.palette_path << std::endl;
+		return false;
+	}
+	std::cerr << "generated " << palette.ColorCount() << " colors into " << settings.palette_path << std::endl;
+	return true;
+}
+
 int main(int argc, char* argv[])
 {
+	DemoSettings settings;
+	for (int i = 1; i < argc; i++) {
+		std::string argument = argv[i];
+		bool has_value = i + 1 < argc;
+		if (argument == "--ppu" && has_value) settings.ppu_type = std::clamp(atoi(argv[++i]), 0, 2);
+		else if (argument == "--sync") settings.sync_enable = true;
+		else if (argument == "--full-frame") settings.full_frame_input = true;
+		else if (argument == "--threads" && has_value) settings.thread_count = std::max(atoi(argv[++i]), 0);
+		else if (argument == "--width" && has_value) settings.output_width = std::max(atoi(argv[++i]), 0);
+		else if (argument == "--input" && has_value) settings.input_path = argv[++i];
+		else if (argument == "--frames" && has_value) settings.frames = atol(argv[++i]);
+		else if (argument == "--y4m" && has_value) settings.y4m_path = argv[++i];
+		else if (argument == "--rgb" && has_value) settings.rgb_path = argv[++i];
+		else if (argument == "--batch" && has_value) settings.batch_pattern = argv[++i];
+		else if (argument == "--output-dir" && has_value) settings.output_directory = argv[++i];
+		else if (argument == "--palette" && has_value) settings.palette_path = argv[++i];
+		else if (argument == "--palette-64") settings.palette_emphasis = false;
+		else if (argument == "--table-cache" && has_value) settings.table_cache_directory = argv[++i];
+		else if (argument == "--profile" && has_value) settings.profile_path = argv[++i];
+		else if (argument == "--save-profile" && has_value) settings.save_profile_path = argv[++i];
+		else if (argument == "--png-preset" && has_value) {
+			std::string name = argv[++i];
+			auto preset = std::find(std::begin(PNGPresetNames), std::end(PNGPresetNames), name);
+			if (preset == std::end(PNGPresetNames)) {
+				std::cerr << "unknown PNG preset " << name << std::endl;
+				return 1;
+			}
+			settings.png_preset = PNGPreset(preset - std::begin(PNGPresetNames));
+		}
+		else {
+			std::cerr << "usage: " << argv[0] << " [--ppu 0-2] [--sync] [--full-frame] [--threads n] [--width n] [--input frames.raw] [--frames n]"
+				" [--png-preset smallest|default|fast|fastest|stored] [--palette file.pal [--palette-64]] [--table-cache dir] [--profile file] [--save-profile file]"
+				" (--y4m file | --rgb file | --batch dir-or-pattern [--output-dir dir])" << std::endl;
+			return 1;
+		}
+	}
+	// a profile decides the PPU type, --ppu only picks the compiled-in profile
+	if (settings.profile_path == nullptr)
+		settings.profile.SetBuiltin(settings.ppu_type);
+	else if (settings.profile.Load(settings.profile_path))
+		settings.ppu_type = settings.profile.GetPPUType();
+	else {
+		std::cerr << settings.profile_path << ": " << settings.profile.Error() << std::endl;
+		return 1;
+	}
+	if (settings.save_profile_path != nullptr) {
+		if (!settings.profile.Save(settings.save_profile_path)) {
+			std::cerr << "could not write " << settings.save_profile_path << std::endl;
+			return 1;
+		}
+		if (settings.batch_pattern == nullptr && settings.palette_path == nullptr && settings.y4m_path == nullptr && settings.rgb_path == nullptr)
+			return 0;
+	}
+	// full frame input is only available in NTSC
+	settings.full_frame_input = settings.full_frame_input && settings.ppu_type == 0;
+	NES_CVBS::SetTableCacheDirectory(settings.table_cache_directory);
+
+	PPUPalette palette;
+	if (settings.palette_path != nullptr) {
+		if (settings.y4m_path != nullptr || settings.rgb_path != nullptr) {
+			std::cerr << "--palette only works alone or with --batch" << std::endl;
+			return 1;
+		}
+		if (!LoadPalette(settings, palette))
+			return 1;
+		if (settings.batch_pattern == nullptr)
+			return 0;
+	}
+
+	if (settings.batch_pattern != nullptr)
+		return BatchFilter(settings, settings.palette_path != nullptr ? &palette : nullptr);
+	if (settings.y4m_path != nullptr || settings.rgb_path != nullptr)
+		return StreamFrames(settings);
+
 	NES_CVBS* nes_filter = (new NES_CVBS(1, 0, false, false, 0));
 	size_t buffer_size = size_t(256 * 240);
 
 	uint16_t* ppu_frame_input = new uint16_t[buffer_size];
 	memset(ppu_frame_input, 0x08, buffer_size * sizeof(uint16_t));
-	uint32_t* rgb_frame_output = new uint32_t[buffer_size];
-	memset(rgb_frame_output, 0, buffer_size * sizeof(uint32_t));
+	size_t output_size = size_t(nes_filter->OutputBufferWidth * nes_filter->OutputBufferHeight);
+	uint32_t* rgb_frame_output = new uint32_t[output_size];
+	memset(rgb_frame_output, 0, output_size * sizeof(uint32_t));
 
-	nes_filter->FilterFrame(ppu_frame_input, rgb_frame_output, 0, true);
+	// both fields are also streamed raw, for offline analysis of longer captures
+	SignalDumpWriter signal_dump;
+	signal_dump.Open("test.cvbs", *nes_filter);
 
-	std::vector<uint8_t> buffer_stretch;
+	nes_filter->FilterFrame(ppu_frame_input, rgb_frame_output, 0, true);
+	signal_dump.WriteField(*nes_filter, 0, true);
 
-	for (size_t i = 0; i < size_t(nes_filter->SignalBufferWidth * nes_filter->SignalBufferHeight); i++) {
-		buffer_stretch.push_back(uint8_t((nes_filter->SignalFieldBuffer[i] >> 8) & 0x00FF));
-		buffer_stretch.push_back(uint8_t(nes_filter->SignalFieldBuffer[i] & 0x00FF));
-	}
+	// 16-bit PNGs are big-endian
+	std::vector<uint8_t> buffer_stretch(size_t(nes_filter->SignalBufferWidth) * nes_filter->SignalBufferHeight * 2);
+	nes_filter->ExportSignalField(buffer_stretch.data());
 
-	export_png("test_odd.png", buffer_stretch, uint32_t(nes_filter->SignalBufferWidth), nes_filter->SignalBufferHeight);
+	export_png("test_odd.png", buffer_stretch, uint32_t(nes_filter->SignalBufferWidth), nes_filter->SignalBufferHeight, settings.png_preset);
 
 	nes_filter->FilterFrame(ppu_frame_input, rgb_frame_output, 1, false);
+	signal_dump.WriteField(*nes_filter, 1, false);
+	signal_dump.Close();
 
-	for (size_t i = 0; i < size_t(nes_filter->SignalBufferWidth * nes_filter->SignalBufferHeight); i++) {
-		buffer_stretch.at(i * 2) = (uint8_t((nes_filter->SignalFieldBuffer[i] >> 8) & 0x00FF));
-		buffer_stretch.at(i * 2 + 1) = (uint8_t(nes_filter->SignalFieldBuffer[i] & 0x00FF));
-	}
+	nes_filter->ExportSignalField(buffer_stretch.data());
 
-	export_png("test_even.png", buffer_stretch, uint32_t(nes_filter->SignalBufferWidth), nes_filter->SignalBufferHeight);
+	export_png("test_even.png", buffer_stretch, uint32_t(nes_filter->SignalBufferWidth), nes_filter->SignalBufferHeight, settings.png_preset);
 
 	// done, claygo
 	delete nes_filter;
@@ -23,11 +23,89 @@ SOFTWARE.
 
 #include <cstdint>
 #include "src/NES-CVBS.h"
+#include "src/SignalDump.h"
+#include "src/PPUFrameLoader.h"
+#include "src/PPUTraceReader.h"
+#include "src/PPUPalette.h"
+#include "src/PPUProfile.h"
 #include "src/lodepng/lodepng.h"
 #include "SDL.h"
 #include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <string>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <vector>
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
 
-void export_png(const char* filename, std::vector<uint8_t>& image, unsigned width, unsigned height) {
+// PNG encoder trade-offs, from smallest to fastest. sizes and times of one signal field are in README.md
+enum PNGPreset {
+	png_smallest,	// lodepng's filter heuristic, full 32 KiB window and longest matches
+	png_default,	// lodepng's defaults: filter heuristic, 2 KiB window, lazy matching
+	png_fast,		// "Up" filter on every line, otherwise the defaults
+	png_fastest,	// "Up" filter, 512 byte window, no lazy matching
+	png_stored		// no filter and no compression
+};
+
+const char* const PNGPresetNames[] = { "smallest", "default", "fast", "fastest", "stored" };
+
+// command line settings of the demo
+struct DemoSettings {
+	int ppu_type = 0;
+	bool sync_enable = false;
+	bool full_frame_input = false;
+	int thread_count = 0;				// 0 = calibrated
+	int output_width = 0;
+	const char* input_path = nullptr;	// memory-mapped raw little-endian uint16_t PPU frames, a test pattern if none
+	const char* y4m_path = nullptr;		// "-" = stdout
+	const char* rgb_path = nullptr;
+	long frames = -1;					// -1 = the whole input
+	const char* batch_pattern = nullptr;	// directory, or files with * and ? in their name
+	const char* output_directory = ".";
+	PNGPreset png_preset = png_fast;	// signal and batch PNGs
+	const char* palette_path = nullptr;	// loaded if it's a valid .pal, otherwise generated and written
+	bool palette_emphasis = true;		// 512 colors, or only the 64 without emphasis
+	const char* table_cache_directory = nullptr;	// generated filter tables, nullptr = always regenerate
+	const char* profile_path = nullptr;	// voltages and timings, instead of the compiled-in ones of ppu_type
+	const char* save_profile_path = nullptr;
+	PPUProfile profile;					// loaded from profile_path, or the compiled-in one of ppu_type
+};
+
+void apply_png_preset(lodepng::State& state, PNGPreset preset) {
+	LodePNGCompressSettings& zlib = state.encoder.zlibsettings;
+	switch (preset) {
+	case png_smallest:
+		zlib.windowsize = 32768;
+		zlib.nicematch = 258;
+		break;
+	case png_default:
+		break;
+	case png_fast:
+		// composite lines repeat the line above closely, so "Up" is about as good as trying every filter
+		state.encoder.filter_strategy = LFS_TWO;
+		break;
+	case png_fastest:
+		state.encoder.filter_strategy = LFS_TWO;
+		zlib.windowsize = 512;
+		zlib.nicematch = 64;
+		zlib.lazymatching = 0;
+		break;
+	case png_stored:
+		state.encoder.filter_strategy = LFS_ZERO;
+		zlib.btype = 0;
+		break;
+	}
+}
+
+void export_png(const char* filename, std::vector<uint8_t>& image, unsigned width, unsigned height, PNGPreset preset = png_fast) {
 	std::vector<unsigned char> png;
 	lodepng::State state; //optionally customize this one
 	state.info_raw.bitdepth = 16;
@@ -35,6 +113,9 @@ void export_png(const char* filename, std::vector<uint8_t>& image, unsigned widt
 	state.info_png.color.bitdepth = 16;
 	state.info_png.color.colortype = LCT_GREY;
 	state.encoder.auto_convert = 0;
+	// signal fields are over a megabyte of filtered scanlines, deflate them on every hardware thread
+	state.encoder.zlibsettings.threads = 0;
+	apply_png_preset(state, preset);
 	unsigned error = lodepng::encode(png, image, width, height, state);
 	if (!error) lodepng::save_file(png, filename);
 
@@ -0,0 +1,159 @@
+/*
+NES-CVBS
+Copyright (c) 2023 Persune
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+
+// timing of a filter stage over the last FilterStatsWindow frames, in nanoseconds
+struct StageTimingStats {
+    double min_ns = 0.0;
+    double mean_ns = 0.0;
+    double p99_ns = 0.0;
+    uint64_t samples = 0;
+};
+
+// time a worker thread spent filtering its share of the field, and waiting on the others.
+// totals since the last reset
+struct WorkerStats {
+    uint64_t busy_ns = 0;
+    uint64_t idle_ns = 0;
+};
+
+struct FilterStats {
+    StageTimingStats emplace;
+    // encode and decode are summed over all worker threads
+    StageTimingStats encode;
+    StageTimingStats decode;
+    // whole FilterFrame() or FilterRegion() call
+    StageTimingStats frame;
+    std::vector<WorkerStats> workers;
+
+    uint64_t frames = 0;
+    // frames filtered with a skipped dot
+    uint64_t dot_skips = 0;
+    // scanlines FilterRegion() didn't have to filter
+    uint64_t lines_skipped = 0;
+};
+
+// monotonic timestamp for the stats, in nanoseconds
+inline uint64_t StatsClock()
+{
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+const int FilterStatsWindow = 256;
+const int FilterStatsMaxWorkers = 64;
+
+// rolling window of stage timings. one thread pushes, any thread can summarize
+class StageTimingWindow {
+    std::atomic<uint64_t> Samples[FilterStatsWindow] = {};
+    std::atomic<uint64_t> Count = 0;
+
+public:
+    void Push(uint64_t ns) {
+        uint64_t count = Count.load(std::memory_order_relaxed);
+        Samples[count % FilterStatsWindow].store(ns, std::memory_order_relaxed);
+        Count.store(count + 1, std::memory_order_release);
+    }
+
+    void Reset() {
+        Count.store(0, std::memory_order_release);
+    }
+
+    StageTimingStats Summarize() const {
+        StageTimingStats stats;
+        uint64_t count = std::min<uint64_t>(Count.load(std::memory_order_acquire), FilterStatsWindow);
+        if (!count) return stats;
+
+        std::vector<uint64_t> samples(count);
+        for (uint64_t i = 0; i < count; i++)
+            samples[i] = Samples[i].load(std::memory_order_relaxed);
+        std::sort(samples.begin(), samples.end());
+
+        double sum = 0.0;
+        for (uint64_t sample : samples) sum += double(sample);
+        stats.min_ns = double(samples.front());
+        stats.mean_ns = sum / double(count);
+        stats.p99_ns = double(samples[((count * 99) + 99) / 100 - 1]);
+        stats.samples = count;
+        return stats;
+    }
+};
+
+// everything the filter counts while it runs. written by the thread calling FilterFrame(),
+// with worker timings handed over after the workers are joined, so nothing here locks
+struct FilterStatsCollector {
+    StageTimingWindow Emplace, Encode, Decode, Frame;
+    std::atomic<uint64_t> WorkerBusy[FilterStatsMaxWorkers] = {};
+    std::atomic<uint64_t> WorkerIdle[FilterStatsMaxWorkers] = {};
+    std::atomic<int> WorkerCount = 0;
+    std::atomic<uint64_t> Frames = 0, DotSkips = 0, LinesSkipped = 0;
+    // set while the filter runs frames that shouldn't count, like its thread count calibration
+    bool Paused = false;
+
+    void AddWorker(int worker, uint64_t busy_ns, uint64_t idle_ns) {
+        // the filter never runs more workers than there are slots
+        if (worker < 0 || worker >= FilterStatsMaxWorkers) return;
+        WorkerBusy[worker].fetch_add(busy_ns, std::memory_order_relaxed);
+        WorkerIdle[worker].fetch_add(idle_ns, std::memory_order_relaxed);
+        if (worker >= WorkerCount.load(std::memory_order_relaxed))
+            WorkerCount.store(worker + 1, std::memory_order_relaxed);
+    }
+
+    void Reset() {
+        Emplace.Reset();
+        Encode.Reset();
+        Decode.Reset();
+        Frame.Reset();
+        for (int worker = 0; worker < FilterStatsMaxWorkers; worker++) {
+            WorkerBusy[worker].store(0, std::memory_order_relaxed);
+            WorkerIdle[worker].store(0, std::memory_order_relaxed);
+        }
+        WorkerCount.store(0, std::memory_order_relaxed);
+        Frames.store(0, std::memory_order_relaxed);
+        DotSkips.store(0, std::memory_order_relaxed);
+        LinesSkipped.store(0, std::memory_order_relaxed);
+    }
+
+    FilterStats Summarize() const {
+        FilterStats stats;
+        stats.emplace = Emplace.Summarize();
+        stats.encode = Encode.Summarize();
+        stats.decode = Decode.Summarize();
+        stats.frame = Frame.Summarize();
+        stats.workers.resize(WorkerCount.load(std::memory_order_relaxed));
+        for (size_t worker = 0; worker < stats.workers.size(); worker++) {
+            stats.workers[worker].busy_ns = WorkerBusy[worker].load(std::memory_order_relaxed);
+            stats.workers[worker].idle_ns = WorkerIdle[worker].load(std::memory_order_relaxed);
+        }
+        stats.frames = Frames.load(std::memory_order_relaxed);
+        stats.dot_skips = DotSkips.load(std::memory_order_relaxed);
+        stats.lines_skipped = LinesSkipped.load(std::memory_order_relaxed);
+        return stats;
+    }
+};
@@ -0,0 +1,120 @@
+/*
+NES-CVBS
+Copyright (c) 2023 Persune
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+
+// begin/end events of the filter stages, kept per thread and written out as a Chrome trace
+// (chrome://tracing, ui.perfetto.dev). only recorded in builds with NES_CVBS_TRACE defined
+
+struct TraceEvent {
+    const char* name;
+    uint64_t begin_ns;
+    uint64_t end_ns;
+    // scanline range of the event, or -1
+    int line_start;
+    int line_end;
+};
+
+const int FilterTraceCapacity = 8192;
+// worker threads get rings 0 to FilterTraceMaxWorkers - 1, the thread calling FilterFrame() gets the last one
+const int FilterTraceMaxWorkers = 64;
+const int FilterTraceCallerRing = FilterTraceMaxWorkers;
+
+// ring buffer of the latest events of a single thread
+struct TraceRing {
+    TraceEvent Events[FilterTraceCapacity] = {};
+    uint64_t Count = 0;
+
+    void Record(const char* name, uint64_t begin_ns, uint64_t end_ns, int line_start, int line_end) {
+        Events[Count % FilterTraceCapacity] = { name, begin_ns, end_ns, line_start, line_end };
+        Count++;
+    }
+};
+
+class FilterTrace {
+    // each ring only ever has one writer at a time, so recording doesn't lock.
+    // rings are allocated by their thread on its first event
+    TraceRing* Rings[FilterTraceMaxWorkers + 1] = {};
+    // set between frames only, so the workers never see it change
+    bool Paused = false;
+
+public:
+    FilterTrace() = default;
+    ~FilterTrace() {
+        for (TraceRing* ring : Rings) delete ring;
+    }
+    FilterTrace(const FilterTrace&) = delete;
+    FilterTrace& operator=(const FilterTrace&) = delete;
+
+    void Record(int ring, const char* name, uint64_t begin_ns, uint64_t end_ns, int line_start = -1, int line_end = -1) {
+        // every ring has one writer, so rings are never shared. the filter never runs more workers than there are rings
+        if (Paused || ring < 0 || ring > FilterTraceCallerRing) return;
+        TraceRing*& trace_ring = Rings[ring];
+        if (trace_ring == nullptr) trace_ring = new TraceRing;
+        trace_ring->Record(name, begin_ns, end_ns, line_start, line_end);
+    }
+
+    // drops events instead of recording them, e.g. while the filter calibrates
+    void SetPaused(bool paused) {
+        Paused = paused;
+    }
+
+    void Clear() {
+        for (TraceRing* ring : Rings)
+            if (ring != nullptr) ring->Count = 0;
+    }
+
+    // writes every event still in the rings as complete ("X") events. call between frames
+    bool Write(const char* filename) const {
+        FILE* file = fopen(filename, "w");
+        if (file == nullptr) return false;
+
+        fprintf(file, "{\"traceEvents\":[\n");
+        fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"NES-CVBS\"}}");
+        for (int ring = 0; ring <= FilterTraceMaxWorkers; ring++) {
+            if (Rings[ring] == nullptr || !Rings[ring]->Count) continue;
+            const TraceRing& trace_ring = *Rings[ring];
+
+            if (ring == FilterTraceCallerRing)
+                fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"filter\"}}", ring);
+            else
+                fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"worker %d\"}}", ring, ring);
+
+            uint64_t first = trace_ring.Count > FilterTraceCapacity ? trace_ring.Count - FilterTraceCapacity : 0;
+            for (uint64_t index = first; index < trace_ring.Count; index++) {
+                const TraceEvent& event = trace_ring.Events[index % FilterTraceCapacity];
+                fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+                    event.name, ring, double(event.begin_ns) / 1000.0, double(event.end_ns - event.begin_ns) / 1000.0);
+                if (event.line_start >= 0)
+                    fprintf(file, ",\"args\":{\"line_start\":%d,\"line_end\":%d}", event.line_start, event.line_end);
+                fprintf(file, "}");
+            }
+        }
+        fprintf(file, "\n],\"displayTimeUnit\":\"ns\"}\n");
+
+        return fclose(file) == 0;
+    }
+};
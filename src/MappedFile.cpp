@@ -0,0 +1,171 @@
+/*
+NES-CVBS
+Copyright (c) 2023 Persune
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+bool MappedFile::Open(const char* filename, MappedFileMode mode)
+{
+    Close();
+    Mode = mode;
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename, mode == mapped_read ? GENERIC_READ : (GENERIC_READ | GENERIC_WRITE), FILE_SHARE_READ, nullptr,
+        mode == mapped_read ? OPEN_EXISTING : CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    FileHandle = file;
+
+    LARGE_INTEGER file_size = {};
+    GetFileSizeEx(file, &file_size);
+    MappedSize = size_t(file_size.QuadPart);
+#else
+    FileDescriptor = open(filename, mode == mapped_read ? O_RDONLY : (O_RDWR | O_CREAT | O_TRUNC), 0644);
+    if (FileDescriptor < 0)
+        return false;
+
+    struct stat file_stat = {};
+    fstat(FileDescriptor, &file_stat);
+    MappedSize = size_t(file_stat.st_size);
+#endif
+
+    if (!Map()) {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+bool MappedFile::Resize(size_t size)
+{
+    if (!IsOpen() || Mode != mapped_write)
+        return false;
+
+    Unmap();
+#ifdef _WIN32
+    LARGE_INTEGER file_size = {};
+    file_size.QuadPart = LONGLONG(size);
+    if (!SetFilePointerEx(FileHandle, file_size, nullptr, FILE_BEGIN) || !SetEndOfFile(FileHandle))
+        return false;
+#else
+    if (ftruncate(FileDescriptor, off_t(size)) != 0)
+        return false;
+#endif
+    MappedSize = size;
+    return Map();
+}
+
+void MappedFile::AdviseSequential()
+{
+    if (MappedData == nullptr)
+        return;
+#ifdef _WIN32
+    // views have no access pattern hint, prefetching the whole range is the closest thing
+#if _WIN32_WINNT >= 0x0602
+    WIN32_MEMORY_RANGE_ENTRY range = {MappedData, MappedSize};
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#endif
+#else
+    madvise(MappedData, MappedSize, MADV_SEQUENTIAL);
+#endif
+}
+
+bool MappedFile::Map()
+{
+    // empty files can't be mapped, there's nothing to map anyway
+    if (MappedSize == 0)
+        return true;
+
+#ifdef _WIN32
+    MappingHandle = CreateFileMappingA(FileHandle, nullptr, Mode == mapped_read ? PAGE_READONLY : PAGE_READWRITE,
+        DWORD(uint64_t(MappedSize) >> 32), DWORD(MappedSize & 0xFFFFFFFF), nullptr);
+    if (MappingHandle == nullptr)
+        return false;
+    MappedData = (uint8_t*)MapViewOfFile(MappingHandle, Mode == mapped_read ? FILE_MAP_READ : FILE_MAP_WRITE, 0, 0, MappedSize);
+    if (MappedData == nullptr) {
+        CloseHandle(MappingHandle);
+        MappingHandle = nullptr;
+        return false;
+    }
+#else
+    void* data = mmap(nullptr, MappedSize, Mode == mapped_read ? PROT_READ : (PROT_READ | PROT_WRITE), MAP_SHARED, FileDescriptor, 0);
+    if (data == MAP_FAILED)
+        return false;
+    MappedData = (uint8_t*)data;
+#endif
+    return true;
+}
+
+void MappedFile::Unmap()
+{
+#ifdef _WIN32
+    if (MappedData != nullptr)
+        UnmapViewOfFile(MappedData);
+    if (MappingHandle != nullptr)
+        CloseHandle(MappingHandle);
+    MappingHandle = nullptr;
+#else
+    if (MappedData != nullptr)
+        munmap(MappedData, MappedSize);
+#endif
+    MappedData = nullptr;
+}
+
+void MappedFile::Close()
+{
+    Unmap();
+#ifdef _WIN32
+    if (FileHandle != nullptr)
+        CloseHandle(FileHandle);
+    FileHandle = nullptr;
+#else
+    if (FileDescriptor >= 0)
+        close(FileDescriptor);
+    FileDescriptor = -1;
+#endif
+    MappedSize = 0;
+}
+
+bool MappedFile::IsOpen() const
+{
+#ifdef _WIN32
+    return FileHandle != nullptr;
+#else
+    return FileDescriptor >= 0;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
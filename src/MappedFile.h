@@ -0,0 +1,68 @@
+/*
+NES-CVBS
+Copyright (c) 2023 Persune
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+// memory-mapped file, through mmap on POSIX and file mappings on Windows
+
+#include <cstdint>
+#include <cstddef>
+
+enum MappedFileMode {
+    mapped_read,    // existing file, read-only
+    mapped_write    // created or truncated, read/write, resizable
+};
+
+class MappedFile
+{
+private:
+    MappedFileMode Mode = mapped_read;
+    uint8_t* MappedData = nullptr;
+    size_t MappedSize = 0;
+#ifdef _WIN32
+    void* FileHandle = nullptr;
+    void* MappingHandle = nullptr;
+#else
+    int FileDescriptor = -1;
+#endif
+
+    bool Map();
+    void Unmap();
+
+public:
+    bool Open(const char* filename, MappedFileMode mode);
+    // sets the file size and maps all of it. write mode only, the mapping may move
+    bool Resize(size_t size);
+    // hints that the mapping will be read front to back, so the OS reads ahead aggressively
+    void AdviseSequential();
+    void Close();
+    bool IsOpen() const;
+
+    uint8_t* Data() const { return MappedData; }
+    size_t Size() const { return MappedSize; }
+
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+};
@@ -24,39 +24,388 @@ SOFTWARE.
 #include "NES-CVBS.h"
 #include <thread>
 #include <iostream>
+#include <numeric>
+#include <algorithm>
+#include <cmath>
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
 
-void NES_CVBS::FilterFrame(uint16_t* ppu_buffer, uint32_t* rgb_buffer, int dot_phase, bool skip_dot)
+// PPUThreadCount is clamped to the stats slots, which have to fit in the trace rings too
+static_assert(FilterTraceMaxWorkers >= FilterStatsMaxWorkers, "every worker needs its own trace ring");
+
+void NES_CVBS::FilterFrame(const uint16_t* ppu_buffer, uint32_t* rgb_buffer, int dot_phase, bool skip_dot)
+{
+    FilterFrame(ppu_buffer, rgb_buffer, xrgb8888, dot_phase, skip_dot);
+}
+
+void NES_CVBS::FilterFrame(const uint16_t* ppu_buffer, void* output_buffer, PixelFormat pixel_format, int dot_phase, bool skip_dot)
 {
+    uint64_t frame_start = StatsClock();
+
     PPURawFrameBuffer = ppu_buffer;
     // place the input frame inside the raw field buffer
-    EmplaceField();
+    EmplaceField(0, FieldBufferHeight);
+    uint64_t emplaced = StatsClock();
+    if (!Stats.Paused)
+        Stats.Emplace.Push(emplaced - frame_start);
+
+    DecoderSignalBuffer = SignalFieldBuffer;
+    FilterFieldAs(pixel_format, output_buffer, dot_phase, skip_dot, 0, FieldBufferHeight, 0, OutputBufferWidth);
+
+    if (OutputInterlace)
+        OutputFieldParity ^= 1;
+
+    uint64_t frame_end = StatsClock();
+    CountFrame(skip_dot, 0, frame_end - frame_start);
+#ifdef NES_CVBS_TRACE
+    Trace.Record(FilterTraceCallerRing, "EmplaceField", frame_start, emplaced, 0, FieldBufferHeight);
+    Trace.Record(FilterTraceCallerRing, "FilterFrame", frame_start, frame_end, 0, FieldBufferHeight);
+#endif
+}
+
+void NES_CVBS::FilterRegion(const uint16_t* ppu_buffer, uint32_t* rgb_buffer, int dot_phase, bool skip_dot, int x, int y, int width, int height)
+{
+    FilterRegion(ppu_buffer, rgb_buffer, xrgb8888, dot_phase, skip_dot, x, y, width, height);
+}
+
+void NES_CVBS::FilterRegion(const uint16_t* ppu_buffer, void* output_buffer, PixelFormat pixel_format, int dot_phase, bool skip_dot, int x, int y, int width, int height)
+{
+    int line_start = std::clamp(y, 0, int(FieldBufferHeight));
+    int line_end = std::clamp(y + height, 0, int(FieldBufferHeight));
+    int dot_start = std::clamp(x, 0, int(FieldBufferWidth));
+    int dot_end = std::clamp(x + width, 0, int(FieldBufferWidth));
+    if (line_start >= line_end || dot_start >= dot_end) return;
+
+    // FilterField() widens the lines to the writer's row alignment, those have to come from this frame too
+    int row_alignment = PixelFormatRowAlignment(pixel_format);
+    line_start = line_start / row_alignment * row_alignment;
+    line_end = std::min((line_end + row_alignment - 1) / row_alignment * row_alignment, int(FieldBufferHeight));
+
+    uint64_t frame_start = StatsClock();
+
+    PPURawFrameBuffer = ppu_buffer;
+    EmplaceField(line_start, line_end);
+    uint64_t emplaced = StatsClock();
+    if (!Stats.Paused)
+        Stats.Emplace.Push(emplaced - frame_start);
+
+    // output columns that overlap the region's dots
+    int pixel_start = (dot_start * OutputBufferWidth) / FieldBufferWidth;
+    int pixel_end = ((dot_end * OutputBufferWidth) + FieldBufferWidth - 1) / FieldBufferWidth;
+
+    DecoderSignalBuffer = SignalFieldBuffer;
+    FilterFieldAs(pixel_format, output_buffer, dot_phase, skip_dot, line_start, line_end, pixel_start, pixel_end);
+
+    uint64_t frame_end = StatsClock();
+    CountFrame(skip_dot, FieldBufferHeight - (line_end - line_start), frame_end - frame_start);
+#ifdef NES_CVBS_TRACE
+    Trace.Record(FilterTraceCallerRing, "EmplaceField", frame_start, emplaced, line_start, line_end);
+    Trace.Record(FilterTraceCallerRing, "FilterRegion", frame_start, frame_end, line_start, line_end);
+#endif
+}
+
+void NES_CVBS::DecodeSignal(const uint16_t* signal_field, uint32_t* rgb_buffer, int dot_phase, bool skip_dot)
+{
+    DecodeSignal(signal_field, rgb_buffer, xrgb8888, dot_phase, skip_dot);
+}
+
+void NES_CVBS::DecodeSignal(const uint16_t* signal_field, void* output_buffer, PixelFormat pixel_format, int dot_phase, bool skip_dot)
+{
+    uint64_t frame_start = StatsClock();
+
+    if (!DetectLinePhase(signal_field))
+        // an empty dot range only runs the encoder's color generator, which records the line phases
+        EncodeField(dot_phase, 0, FieldBufferHeight, skip_dot, 0, 0);
+
+    // FilterField() skips encoding while the decoder reads an external field
+    DecoderSignalBuffer = signal_field;
+    FilterFieldAs(pixel_format, output_buffer, dot_phase, skip_dot, 0, FieldBufferHeight, 0, OutputBufferWidth);
+    DecoderSignalBuffer = SignalFieldBuffer;
+
+    if (OutputInterlace)
+        OutputFieldParity ^= 1;
+
+    uint64_t frame_end = StatsClock();
+    CountFrame(skip_dot, 0, frame_end - frame_start);
+#ifdef NES_CVBS_TRACE
+    Trace.Record(FilterTraceCallerRing, "DecodeSignal", frame_start, frame_end, 0, FieldBufferHeight);
+#endif
+}
+
+bool NES_CVBS::DetectLinePhase(const uint16_t* signal_field)
+{
+    if (!PPUSyncEnable)
+        return false;
+
+    TrackBurst(signal_field, 0, SignalBufferHeight);
+    return true;
+}
+
+void NES_CVBS::ExportSignalField(uint8_t* big_endian_buffer, const uint16_t* signal_field) const
+{
+    if (signal_field == nullptr)
+        signal_field = SignalFieldBuffer;
+    size_t count = size_t(SignalBufferWidth) * SignalBufferHeight;
+    size_t i = 0;
+#if defined(__SSSE3__)
+    // swap the bytes of 8 samples at a time
+    const __m128i swap = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    for (; i + 8 <= count; i += 8) {
+        __m128i samples = _mm_loadu_si128((const __m128i*)&signal_field[i]);
+        _mm_storeu_si128((__m128i*)&big_endian_buffer[i * 2], _mm_shuffle_epi8(samples, swap));
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    // no byte shuffle before SSSE3, but shifting each 16-bit lane both ways does the same
+    for (; i + 8 <= count; i += 8) {
+        __m128i samples = _mm_loadu_si128((const __m128i*)&signal_field[i]);
+        _mm_storeu_si128((__m128i*)&big_endian_buffer[i * 2], _mm_or_si128(_mm_slli_epi16(samples, 8), _mm_srli_epi16(samples, 8)));
+    }
+#endif
+    for (; i < count; i++) {
+        big_endian_buffer[(i * 2) + 0] = uint8_t(signal_field[i] >> 8);
+        big_endian_buffer[(i * 2) + 1] = uint8_t(signal_field[i]);
+    }
+}
+
+void NES_CVBS::GeneratePalette(uint8_t* palette, int color_count)
+{
+    color_count = std::clamp(color_count, 0, 512);
+    int input_width = PPUFullFrameInput ? PPURasterTimings.visible_width : PPURasterTimings.active_pixels;
+    int input_height = PPUFullFrameInput ? PPURasterTimings.visible_height : PPURasterTimings.active_scanlines;
+    std::vector<uint16_t> ppu_frame(size_t(input_width) * input_height);
+    const uint16_t* ppu_buffer = PPURawFrameBuffer;
+
+    // a few lines in the middle of the picture cover every line phase of both NTSC and PAL.
+    // the middle fifth of each line is far enough from the borders to be the flat color
+    int line_start = input_height / 2, line_end = line_start + 6;
+    int pixel_start = (OutputBufferWidth * 2) / 5, pixel_end = (OutputBufferWidth * 3) / 5;
+    std::vector<float> luma(OutputBufferWidth), chroma_u(OutputBufferWidth), chroma_v(OutputBufferWidth);
+
+    for (int color = 0; color < color_count; color++) {
+        std::fill(ppu_frame.begin(), ppu_frame.end(), uint16_t(color));
+        PPURawFrameBuffer = ppu_frame.data();
+        EmplaceField(line_start, line_end);
+        EncodeField(0, line_start, line_end, false, 0, FieldBufferWidth);
+
+        // average in YUV and convert once, so no single pixel's clipping skews the color
+        float y = 0.0f, u = 0.0f, v = 0.0f;
+        for (int scanline = line_start; scanline < line_end; scanline++) {
+            DecodeLine(&SignalFieldBuffer[size_t(scanline) * SignalBufferWidth], SignalLinePhase[scanline], pixel_start, pixel_end,
+                luma.data(), chroma_u.data(), chroma_v.data());
+            for (int pixel_index = pixel_start; pixel_index < pixel_end; pixel_index++) {
+                y += luma[pixel_index];
+                u += chroma_u[pixel_index];
+                v += chroma_v[pixel_index];
+            }
+        }
+        float pixels = float((line_end - line_start) * (pixel_end - pixel_start));
+        float r, g, b;
+        YUVToRGB(y / pixels, u / pixels, v / pixels, r, g, b);
+        palette[(color * 3) + 0] = uint8_t(r * 255.0f + 0.5f);
+        palette[(color * 3) + 1] = uint8_t(g * 255.0f + 0.5f);
+        palette[(color * 3) + 2] = uint8_t(b * 255.0f + 0.5f);
+    }
+
+    PPURawFrameBuffer = ppu_buffer;
+}
+
+void NES_CVBS::TrackBurst(const uint16_t* signal_field, int line_start, int line_end)
+{
+    const double pi = 3.14159265358979323846;
+    // loop gains of the PLL, for the phase and for the line to line phase drift
+    const float phase_gain = 0.25f;
+    const float drift_gain = 0.02f;
+
+    int burst_length = int(DecoderBurstCos.size());
+    // a clean burst's fundamental is about 1.27x half its peak to peak level. take half of that as found
+    float burst_level = std::abs(float(SignalLevelLUT[1][0][0x41]) - float(SignalLevelLUT[0][0][0x41])) / 2;
+    float burst_found = 0.32f * burst_level * burst_length;
+
+    // color generator phases the line start moves by from one line to the next
+    int line_delta = SignalBufferWidth % 12;
+
+    float phase = 0.0f, drift = 0.0f;
+    bool locked = false;
+    for (int scanline = line_start; scanline < line_end; scanline++) {
+        const uint16_t* burst = &signal_field[size_t(scanline) * SignalBufferWidth + DecoderBurstStart];
+
+        // correlate the burst window with the subcarrier
+        float burst_i = 0.0f, burst_q = 0.0f;
+        for (int sample = 0; sample < burst_length; sample++) {
+            burst_i += float(burst[sample]) * DecoderBurstCos[sample];
+            burst_q += float(burst[sample]) * DecoderBurstSin[sample];
+        }
+
+        // PAL swings the phase on odd lines
+        float predicted = phase + float(line_delta) + drift;
+        if (PPUType >= 1) predicted += (scanline & 1) ? 3.0f : -3.0f;
+
+        if (burst_i * burst_i + burst_q * burst_q >= burst_found * burst_found) {
+            // the encoder's burst is high where (colorburst_phase + phase) % 12 < 6, so its fundamental peaks 2.5 phases in
+            float measured = float(std::atan2(-burst_q, burst_i) * 12 / (2 * pi)) - PPURasterTimings.colorburst_phase + 2.5f;
+            float error = std::remainder(measured - predicted, 12.0f);
+            // a whole phase off is a step in the signal (e.g. the skipped dot), not noise. relock to it
+            if (!locked || std::abs(error) >= 1.0f) {
+                phase = measured;
+                drift = 0.0f;
+                locked = true;
+            }
+            else {
+                drift += drift_gain * error;
+                phase = predicted + phase_gain * error;
+            }
+        }
+        else
+            // vertical sync lines carry no burst, the color generator runs on
+            phase = predicted;
+
+        phase = std::fmod(phase, 12.0f);
+        if (phase < 0.0f) phase += 12.0f;
+
+        // snap to 1/64 of a phase, so clean bursts give exact whole phases
+        float snapped = std::round(phase * 64.0f) / 64.0f;
+        float whole = std::floor(snapped);
+        SignalLinePhase[scanline] = uint8_t(int(whole) % 12);
+        SignalLinePhaseOffset[scanline] = snapped - whole;
+    }
+}
+
+void NES_CVBS::CountFrame(bool skip_dot, int lines_skipped, uint64_t frame_ns)
+{
+    if (Stats.Paused)
+        return;
+    Stats.Frame.Push(frame_ns);
+    Stats.Frames.fetch_add(1, std::memory_order_relaxed);
+    if (skip_dot && PPUType == 0)
+        Stats.DotSkips.fetch_add(1, std::memory_order_relaxed);
+    Stats.LinesSkipped.fetch_add(uint64_t(lines_skipped), std::memory_order_relaxed);
+}
+
+FilterStats NES_CVBS::GetStats() const
+{
+    return Stats.Summarize();
+}
+
+void NES_CVBS::ResetStats()
+{
+    Stats.Reset();
+}
+
+bool NES_CVBS::WriteTrace(const char* filename)
+{
+#ifdef NES_CVBS_TRACE
+    bool written = Trace.Write(filename);
+    Trace.Clear();
+    return written;
+#else
+    (void)filename;
+    return false;
+#endif
+}
+
+void NES_CVBS::FilterFieldAs(PixelFormat pixel_format, void* output_buffer, int dot_phase, bool skip_dot, int line_start, int line_end, int pixel_start, int pixel_end)
+{
+    // pick the decoder's store stage once per frame, not per pixel
+    switch (pixel_format) {
+    case bgra8888:
+        FilterField<PixelWriterBGRA8888>(output_buffer, dot_phase, skip_dot, line_start, line_end, pixel_start, pixel_end);
+        break;
+    case rgb565:
+        FilterField<PixelWriterRGB565>(output_buffer, dot_phase, skip_dot, line_start, line_end, pixel_start, pixel_end);
+        break;
+    case xrgb2101010:
+        FilterField<PixelWriterXRGB2101010>(output_buffer, dot_phase, skip_dot, line_start, line_end, pixel_start, pixel_end);
+        break;
+    case rgb_planar_float:
+        FilterField<PixelWriterRGBPlanarFloat>(output_buffer, dot_phase, skip_dot, line_start, line_end, pixel_start, pixel_end);
+        break;
+    case yuv420_planar:
+        FilterField<PixelWriterYUV420>(output_buffer, dot_phase, skip_dot, line_start, line_end, pixel_start, pixel_end);
+        break;
+    case yuv422_planar:
+        FilterField<PixelWriterYUV422>(output_buffer, dot_phase, skip_dot, line_start, line_end, pixel_start, pixel_end);
+        break;
+    default:
+        FilterField<PixelWriterXRGB8888>(output_buffer, dot_phase, skip_dot, line_start, line_end, pixel_start, pixel_end);
+        break;
+    }
+}
+
+template <typename PixelWriter>
+void NES_CVBS::FilterField(void* output_buffer, int dot_phase, bool skip_dot, int line_start, int line_end, int pixel_start, int pixel_end)
+{
+    // widen the area to what the writer can store on its own (chroma shared by pixel pairs)
+    int row_alignment = PixelWriterRowAlignment<PixelWriter>;
+    int column_alignment = PixelWriterColumnAlignment<PixelWriter>;
+    line_start = line_start / row_alignment * row_alignment;
+    line_end = std::min((line_end + row_alignment - 1) / row_alignment * row_alignment, int(FieldBufferHeight));
+    pixel_start = pixel_start / column_alignment * column_alignment;
+    pixel_end = std::min((pixel_end + column_alignment - 1) / column_alignment * column_alignment, int(OutputBufferWidth));
+
+    // dots the decoder's kernel reaches into for these output columns
+    int dot_start = std::max(DecoderSampleStart(pixel_start) / PPURasterTimings.samples_per_pixel, 0);
+    int dot_end = std::min((DecoderSampleStart(pixel_end - 1) + DecoderKernelTaps + PPURasterTimings.samples_per_pixel - 1) / PPURasterTimings.samples_per_pixel,
+        int(FieldBufferWidth));
+
+    // dots the burst tracker reads, encoded too when they're outside the area (regions right of the burst)
+    bool track_burst = DecoderBurstLock && PPUSyncEnable;
+    int burst_dot_start = DecoderBurstStart / PPURasterTimings.samples_per_pixel;
+    int burst_dot_end = (DecoderBurstStart + int(DecoderBurstCos.size()) + PPURasterTimings.samples_per_pixel - 1) / PPURasterTimings.samples_per_pixel;
+    bool encode_burst = track_burst && (burst_dot_start < dot_start || burst_dot_end > dot_end);
+
+    int line_count = line_end - line_start;
+
+    // each worker's encode and decode time, handed to the stats once the workers are joined
+    int worker_count = std::max(PPUThreadCount, 1);
+    std::vector<uint64_t> encode_ns(worker_count), decode_ns(worker_count);
+    auto filter_chunk = [&](int thread_number, int chunk_start, int chunk_end) {
+        uint64_t start = StatsClock();
+        // external fields from DecodeSignal() are decoded as they are
+        if (DecoderSignalBuffer == SignalFieldBuffer) {
+            EncodeField(dot_phase, chunk_start, chunk_end, skip_dot, dot_start, dot_end);
+            // lock to the burst that was just encoded, instead of the encoder's phases
+            if (track_burst) {
+                if (encode_burst)
+                    EncodeField(dot_phase, chunk_start, chunk_end, skip_dot, burst_dot_start, burst_dot_end);
+                TrackBurst(SignalFieldBuffer, chunk_start, chunk_end);
+            }
+        }
+        uint64_t encoded = StatsClock();
+        DecodeField<PixelWriter>(output_buffer, chunk_start, chunk_end, pixel_start, pixel_end);
+        uint64_t decoded = StatsClock();
+        encode_ns[thread_number] = encoded - start;
+        decode_ns[thread_number] = decoded - encoded;
+#ifdef NES_CVBS_TRACE
+        Trace.Record(thread_number, "EncodeField", start, encoded, chunk_start, chunk_end);
+        Trace.Record(thread_number, "DecodeField", encoded, decoded, chunk_start, chunk_end);
+#endif
+    };
+
+    uint64_t field_start = StatsClock();
 
     if (PPUThreadCount > 1) {
-        int dot_phase_buffer = dot_phase;
-        int scanline_index = 0;
+        int scanline_index = line_start;
 
         // split the work into n number of threads
-        int field_chunk_size = (FieldBufferHeight / PPUThreadCount),
+        // some writers need the chunks to start on a row multiple (4:2:0 chroma is shared by row pairs)
+        int field_chunk_size = (line_count / PPUThreadCount) / row_alignment * row_alignment,
             field_chunk_size_remainder = 0;
         // if the thread count doesn't divide the field evenly, relegate the nth thread to the remaining area
-        if (FieldBufferHeight % PPUThreadCount) {
-            field_chunk_size_remainder = FieldBufferHeight - (field_chunk_size * (PPUThreadCount - 1));
+        if (field_chunk_size * PPUThreadCount != line_count) {
+            field_chunk_size_remainder = line_count - (field_chunk_size * (PPUThreadCount - 1));
         }
 
         std::vector<std::thread> thread_vector;
         for (int thread_number = 0; thread_number < PPUThreadCount; thread_number++) {
             if (field_chunk_size_remainder && (thread_number == (PPUThreadCount - 1))){
-                thread_vector.emplace_back([&, scanline_index]() {
-                    EncodeField(dot_phase_buffer, scanline_index, scanline_index + field_chunk_size_remainder, skip_dot);
-                    DecodeField(rgb_buffer, dot_phase_buffer, scanline_index, scanline_index + field_chunk_size_remainder, skip_dot);
-                    });
+                thread_vector.emplace_back(filter_chunk, thread_number, scanline_index, scanline_index + field_chunk_size_remainder);
                 scanline_index += field_chunk_size_remainder;
             }
             else {
-                thread_vector.emplace_back([&, scanline_index]() {
-                    EncodeField(dot_phase_buffer, scanline_index, scanline_index + field_chunk_size, skip_dot);
-                    DecodeField(rgb_buffer, dot_phase_buffer, scanline_index, scanline_index + field_chunk_size, skip_dot);
-                    });
+                thread_vector.emplace_back(filter_chunk, thread_number, scanline_index, scanline_index + field_chunk_size);
                 scanline_index += field_chunk_size;
             }
         }
@@ -64,9 +413,21 @@ void NES_CVBS::FilterFrame(uint16_t* ppu_buffer, uint32_t* rgb_buffer, int dot_p
             thread.join();
     }
     else {
-        EncodeField(dot_phase, 0, FieldBufferHeight, skip_dot);
-        DecodeField(rgb_buffer, dot_phase, 0, FieldBufferHeight, skip_dot);
+        filter_chunk(0, line_start, line_end);
     }
+
+    if (Stats.Paused)
+        return;
+    uint64_t field_ns = StatsClock() - field_start;
+    uint64_t encode_total = 0, decode_total = 0;
+    for (int worker = 0; worker < worker_count; worker++) {
+        uint64_t busy_ns = encode_ns[worker] + decode_ns[worker];
+        Stats.AddWorker(worker, busy_ns, field_ns > busy_ns ? field_ns - busy_ns : 0);
+        encode_total += encode_ns[worker];
+        decode_total += decode_ns[worker];
+    }
+    Stats.Encode.Push(encode_total);
+    Stats.Decode.Push(decode_total);
 }
 
 void NES_CVBS::ApplySettings(double brightness_delta, double contrast_delta, double hue_delta, double saturation_delta)
@@ -91,35 +452,187 @@ void NES_CVBS::ApplySettings(double brightness_delta, double contrast_delta, dou
         PPURasterTimings = PPU2C02Timings;
         break;
     }
+    if (PPUCustomProfile) {
+        ppu_voltages = PPUCustomVoltages;
+        PPURasterTimings = PPUCustomTimings;
+    }
 
     FieldBufferWidth = PPUSyncEnable ? PPURasterTimings.field_width : PPURasterTimings.visible_width;
     FieldBufferHeight = SignalBufferHeight = PPUSyncEnable ? PPURasterTimings.field_height : PPURasterTimings.visible_height;
     SignalBufferWidth = FieldBufferWidth * PPURasterTimings.samples_per_pixel;
+    OutputBufferWidth = OutputWidth > 0 ? uint16_t(OutputWidth) : FieldBufferWidth;
+    OutputBufferHeight = FieldBufferHeight * OutputRowsPerLine;
 
-    InitializeSignalLevelLUT(BrightnessDelta, ContrastDelta, ppu_voltages);
+    uint64_t table_key = TableCacheKey(ppu_voltages);
+    if (!LoadTables(table_key)) {
+        InitializeSignalLevelLUT(BrightnessDelta, ContrastDelta, ppu_voltages);
 
-    InitializeDecoder(HueDelta, SaturationDelta);
+        InitializeDecoder(HueDelta, SaturationDelta, ppu_voltages);
+
+        SaveTables(table_key);
+    }
 
     if (RawFieldBuffer != nullptr)
         delete[] RawFieldBuffer;
     if (SignalFieldBuffer != nullptr)
         delete[] SignalFieldBuffer;
+    if (SignalLinePhase != nullptr)
+        delete[] SignalLinePhase;
+    if (SignalLinePhaseOffset != nullptr)
+        delete[] SignalLinePhaseOffset;
 
     RawFieldBuffer = new PPUDotType[FieldBufferWidth * FieldBufferHeight];
     SignalFieldBuffer = new uint16_t[SignalBufferWidth * SignalBufferHeight];
+    SignalLinePhase = new uint8_t[SignalBufferHeight]();
+    SignalLinePhaseOffset = new float[SignalBufferHeight]();
+    DecoderSignalBuffer = SignalFieldBuffer;
     
     InitializeField();
 
     PPU2C04LUT = PaletteLUT_2C04[PPU2C04Rev];
+
+    // field size and output size both change the best split
+    if (PPUThreadCountAuto)
+        CalibrateThreadCount(PPUThreadCountMax);
+}
+
+const std::vector<uint64_t>& NES_CVBS::CalibrateThreadCount(int max_thread_count, int iterations)
+{
+    if (max_thread_count <= 0)
+        max_thread_count = int(std::thread::hardware_concurrency());
+    // every thread needs at least a row pair to work on
+    max_thread_count = std::clamp(max_thread_count, 1, std::min(FilterStatsMaxWorkers, FieldBufferHeight / 2));
+    iterations = std::max(iterations, 1);
+
+    // busy synthetic frame, so no thread count gets an easier field than the others
+    int input_width = PPUFullFrameInput ? PPURasterTimings.visible_width : PPURasterTimings.active_pixels;
+    int input_height = PPUFullFrameInput ? PPURasterTimings.visible_height : PPURasterTimings.active_scanlines;
+    std::vector<uint16_t> ppu_frame(size_t(input_width) * input_height);
+    uint32_t seed = 0x1234567;
+    for (auto& pixel : ppu_frame) {
+        seed = seed * 1664525 + 1013904223;
+        pixel = uint16_t(seed >> 23);
+    }
+    std::vector<uint32_t> rgb_frame(size_t(OutputBufferWidth) * OutputBufferHeight);
+
+    int thread_count = PPUThreadCount;
+    int field_parity = OutputFieldParity;
+    const uint16_t* ppu_buffer = PPURawFrameBuffer;
+
+    // the calibration frames are the filter's own, so they don't go into the caller's stats and trace
+    Stats.Paused = true;
+#ifdef NES_CVBS_TRACE
+    Trace.SetPaused(true);
+#endif
+
+    ThreadScaling.assign(max_thread_count, 0);
+    for (int threads = 1; threads <= max_thread_count; threads++) {
+        PPUThreadCount = threads;
+        // first frame warms up the caches, then keep the fastest
+        FilterFrame(ppu_frame.data(), rgb_frame.data(), 0, false);
+        uint64_t best_ns = UINT64_MAX;
+        for (int iteration = 0; iteration < iterations; iteration++) {
+            uint64_t start = StatsClock();
+            FilterFrame(ppu_frame.data(), rgb_frame.data(), 0, false);
+            best_ns = std::min(best_ns, StatsClock() - start);
+        }
+        ThreadScaling[threads - 1] = best_ns;
+    }
+
+    // only switch away from the current count when something is measurably faster
+    PPUThreadCount = std::clamp(thread_count, 1, max_thread_count);
+    for (int threads = 1; threads <= max_thread_count; threads++) {
+        if (ThreadScaling[threads - 1] * 20 < ThreadScaling[PPUThreadCount - 1] * 19)
+            PPUThreadCount = threads;
+    }
+
+    OutputFieldParity = field_parity;
+    PPURawFrameBuffer = ppu_buffer;
+    Stats.Paused = false;
+#ifdef NES_CVBS_TRACE
+    Trace.SetPaused(false);
+#endif
+    return ThreadScaling;
+}
+
+void NES_CVBS::SetAutoThreadCount(bool enable, int max_thread_count)
+{
+    PPUThreadCountAuto = enable;
+    PPUThreadCountMax = max_thread_count;
+    if (enable)
+        CalibrateThreadCount(PPUThreadCountMax);
+}
+
+int NES_CVBS::GetThreadCount() const
+{
+    return std::max(PPUThreadCount, 1);
+}
+
+void NES_CVBS::SetBurstLock(bool enable)
+{
+    DecoderBurstLock = enable;
+}
+
+int NES_CVBS::GetPPUType() const
+{
+    return PPUType;
+}
+
+const PPUTimings& NES_CVBS::GetTimings() const
+{
+    return PPURasterTimings;
+}
+
+uint16_t NES_CVBS::GetSyncThreshold() const
+{
+    return uint16_t((SignalLevelLUT[0][0][0x40] + SignalLevelLUT[1][0][0x40]) / 2);
+}
+
+const std::vector<uint64_t>& NES_CVBS::GetThreadScaling() const
+{
+    return ThreadScaling;
+}
+
+void NES_CVBS::SetOutputWidth(int output_width)
+{
+    OutputWidth = output_width;
+    ApplySettings(BrightnessDelta, ContrastDelta, HueDelta, SaturationDelta);
+}
+
+void NES_CVBS::SetProfile(const CompositeOutputLevel& voltages, const PPUTimings& timings)
+{
+    PPUCustomProfile = true;
+    PPUCustomVoltages = voltages;
+    PPUCustomTimings = timings;
+    ApplySettings(BrightnessDelta, ContrastDelta, HueDelta, SaturationDelta);
+}
+
+void NES_CVBS::ResetProfile()
+{
+    PPUCustomProfile = false;
+    ApplySettings(BrightnessDelta, ContrastDelta, HueDelta, SaturationDelta);
+}
+
+void NES_CVBS::SetScanlineRows(int rows_per_line, const std::vector<float>& row_gains, bool interlace)
+{
+    OutputRowsPerLine = std::max(rows_per_line, 1);
+    // rows without a given gain are written at full level
+    OutputRowGains.assign(OutputRowsPerLine, 1.0f);
+    std::copy_n(row_gains.begin(), std::min(row_gains.size(), OutputRowGains.size()), OutputRowGains.begin());
+    OutputInterlace = interlace;
+    OutputFieldParity = 0;
+    ApplySettings(BrightnessDelta, ContrastDelta, HueDelta, SaturationDelta);
 }
 
-NES_CVBS::NES_CVBS(int ppu_type, int ppu_2c04_rev, bool ppu_sync_enable, bool ppu_full_frame_input, int ppu_thread_count)
+NES_CVBS::NES_CVBS(int ppu_type, int ppu_2c04_rev, bool ppu_sync_enable, bool ppu_full_frame_input, int ppu_thread_count, int output_width)
 {
     PPUType = ppu_type;
     PPU2C04Rev = ppu_2c04_rev;
     PPUSyncEnable = ppu_sync_enable;
     PPUFullFrameInput = ppu_full_frame_input;
-    PPUThreadCount = ppu_thread_count;
+    // each worker gets its own stats slot and trace ring
+    PPUThreadCount = std::clamp(ppu_thread_count, 0, FilterStatsMaxWorkers);
+    OutputWidth = output_width;
 
     ApplySettings(BrightnessDelta, ContrastDelta, HueDelta, SaturationDelta);
 }
@@ -128,6 +641,8 @@ NES_CVBS::~NES_CVBS()
 {
     delete[] RawFieldBuffer;
     delete[] SignalFieldBuffer;
+    delete[] SignalLinePhase;
+    delete[] SignalLinePhaseOffset;
 }
 
 void NES_CVBS::InitializeSignalLevelLUT(double brightness_delta, double contrast_delta, CompositeOutputLevel ppu_voltages)
@@ -162,8 +677,93 @@ void NES_CVBS::InitializeSignalLevelLUT(double brightness_delta, double contrast
     }
 }
 
-void NES_CVBS::InitializeDecoder(double hue_delta, double saturation_delta)
+void NES_CVBS::InitializeDecoderLayout()
 {
+    // resampling kernel, reduced to its repeating phases
+    int input_width = SignalBufferWidth;
+    int output_width = OutputBufferWidth;
+    int phase_cycle = std::gcd(input_width, output_width);
+    DecoderKernelPhases = output_width / phase_cycle;
+    DecoderKernelStride = input_width / phase_cycle;
+
+    // tent half-width in samples. when upscaling, fall back to linear interpolation
+    double step = double(input_width) / output_width;
+    double radius = std::max(step, 1.0);
+    DecoderKernelTaps = int(std::ceil(2 * radius)) + 12;
+
+    DecoderKernelOffset.assign(DecoderKernelPhases, 0);
+    for (int kernel_phase = 0; kernel_phase < DecoderKernelPhases; kernel_phase++) {
+        double center = (kernel_phase + 0.5) * step - 0.5;
+        DecoderKernelOffset[kernel_phase] = int(std::floor(center - radius - 5.5)) + 1;
+    }
+
+    // colorburst correlator, over whole subcarrier cycles in the middle of the burst
+    int burst_start = (PPURasterTimings.horizontal_sync + PPURasterTimings.back_porch_first) * PPURasterTimings.samples_per_pixel;
+    int burst_samples = PPURasterTimings.colorburst * PPURasterTimings.samples_per_pixel;
+    int burst_length = burst_samples / 12 * 12;
+    DecoderBurstStart = burst_start + (burst_samples - burst_length) / 2;
+    DecoderBurstCos.resize(burst_length);
+    DecoderBurstSin.resize(burst_length);
+}
+
+void NES_CVBS::InitializeDecoder(double hue_delta, double saturation_delta, CompositeOutputLevel ppu_voltages)
+{
+    const double pi = 3.14159265358979323846;
+
+    // black and white points of the signal, without brightness and contrast applied
+    double sync = ppu_voltages.sync[0];
+    double white = ppu_voltages.signal[3][1][0];
+    DecoderBlackLevel = float((ppu_voltages.sync[1] - sync) / (white - sync) * 0xFFFF);
+    DecoderGain = 1.0f / (float(0xFFFF) - DecoderBlackLevel);
+
+    // a hue's square wave is centered 3 phases before its hue number.
+    // rotate the demodulation axes so that colorburst lands on -U
+    double burst_angle = 2 * pi * (PPURasterTimings.colorburst_phase - 3) / 12;
+    double axis_angle = pi - burst_angle + (hue_delta * pi / 180);
+    // the lowpass halves the amplitude of the demodulated product
+    double chroma_gain = 2 * (saturation_delta + 1) * DecoderGain;
+
+    InitializeDecoderLayout();
+    double step = double(SignalBufferWidth) / OutputBufferWidth;
+    double radius = std::max(step, 1.0);
+
+    DecoderKernel.assign(size_t(DecoderKernelPhases) * DecoderKernelTaps, 0.0f);
+
+    for (int kernel_phase = 0; kernel_phase < DecoderKernelPhases; kernel_phase++) {
+        double center = (kernel_phase + 0.5) * step - 0.5;
+        int first_tap = DecoderKernelOffset[kernel_phase];
+        float* kernel = &DecoderKernel[size_t(kernel_phase) * DecoderKernelTaps];
+
+        // discrete convolution of a 12-sample box with the sampled tent,
+        // which keeps a null at the subcarrier frequency for both luma and chroma
+        double kernel_sum = 0.0;
+        for (int tap = 0; tap < DecoderKernelTaps; tap++) {
+            double weight = 0.0;
+            for (int box = 0; box < 12; box++) {
+                double distance = std::abs((first_tap + tap) - box + 5.5 - center);
+                weight += std::max(0.0, 1.0 - distance / radius);
+            }
+            kernel[tap] = float(weight);
+            kernel_sum += weight;
+        }
+        for (int tap = 0; tap < DecoderKernelTaps; tap++)
+            kernel[tap] = float(kernel[tap] / kernel_sum);
+    }
+
+    // colorburst correlator
+    for (size_t sample = 0; sample < DecoderBurstCos.size(); sample++) {
+        double angle = 2 * pi * double((DecoderBurstStart + sample) % 12) / 12;
+        DecoderBurstCos[sample] = float(std::cos(angle));
+        DecoderBurstSin[sample] = float(std::sin(angle));
+    }
+
+    DecoderCarrierU.resize(size_t(12) + DecoderKernelTaps);
+    DecoderCarrierV.resize(size_t(12) + DecoderKernelTaps);
+    for (size_t phase = 0; phase < DecoderCarrierU.size(); phase++) {
+        double angle = 2 * pi * double(phase % 12) / 12 - axis_angle;
+        DecoderCarrierU[phase] = float(chroma_gain * std::cos(angle));
+        DecoderCarrierV[phase] = float(-chroma_gain * std::sin(angle));
+    }
 }
 
 void NES_CVBS::InitializeField()
@@ -215,8 +815,9 @@ void NES_CVBS::InitializeField()
     }
 }
 
-void NES_CVBS::EmplaceField()
+void NES_CVBS::EmplaceField(int line_start, int line_end)
 {
+    const uint16_t* ppu_buffer = nullptr;
     uint16_t pixel_offset = 0;
     uint16_t visible_scanline = PPURasterTimings.active_scanlines + PPURasterTimings.postrender_scanlines;
     if (PPUSyncEnable) pixel_offset += PPURasterTimings.horizontal_sync +
@@ -225,36 +826,39 @@ void NES_CVBS::EmplaceField()
         PPURasterTimings.back_porch_second;
     uint16_t pixel_index = 0, pixel_threshold = 0, scanline_threshold = 0;
     if (PPUFullFrameInput && PPUType == 0) {
-        for (uint16_t scanline = 0; scanline < visible_scanline; scanline++) {
+        // every input scanline is visible_width pixels long
+        ppu_buffer = PPURawFrameBuffer + (size_t(line_start) * PPURasterTimings.visible_width);
+        for (uint16_t scanline = uint16_t(line_start); scanline < std::min(line_end, int(visible_scanline)); scanline++) {
             pixel_index = pixel_offset;
             pixel_threshold = pixel_index;
             scanline_threshold = 0;
             if (ScanlineIsIn(PPURasterTimings.active_scanlines, scanline, scanline_threshold)) {
-                WritePixelsIn(PPURasterTimings.gray_pulse, RawFieldBuffer, pixel_index, scanline, pixel_threshold, blank_level, &PPURawFrameBuffer);
-                WritePixelsIn(PPURasterTimings.border_left, RawFieldBuffer, pixel_index, scanline, pixel_threshold, blank_level, &PPURawFrameBuffer);
-                WritePixelsIn(PPURasterTimings.active_pixels, RawFieldBuffer, pixel_index, scanline, pixel_threshold, blank_level, &PPURawFrameBuffer);
-                WritePixelsIn(PPURasterTimings.border_right, RawFieldBuffer, pixel_index, scanline, pixel_threshold, blank_level, &PPURawFrameBuffer);
+                WritePixelsIn(PPURasterTimings.gray_pulse, RawFieldBuffer, pixel_index, scanline, pixel_threshold, blank_level, &ppu_buffer);
+                WritePixelsIn(PPURasterTimings.border_left, RawFieldBuffer, pixel_index, scanline, pixel_threshold, blank_level, &ppu_buffer);
+                WritePixelsIn(PPURasterTimings.active_pixels, RawFieldBuffer, pixel_index, scanline, pixel_threshold, blank_level, &ppu_buffer);
+                WritePixelsIn(PPURasterTimings.border_right, RawFieldBuffer, pixel_index, scanline, pixel_threshold, blank_level, &ppu_buffer);
             }
             else {
-                WritePixelsIn(PPURasterTimings.gray_pulse, RawFieldBuffer, pixel_index, scanline, pixel_threshold, blank_level, &PPURawFrameBuffer);
-                WritePixelsIn(PPURasterTimings.border_bottom, RawFieldBuffer, pixel_index, scanline, pixel_threshold, blank_level, &PPURawFrameBuffer);
+                WritePixelsIn(PPURasterTimings.gray_pulse, RawFieldBuffer, pixel_index, scanline, pixel_threshold, blank_level, &ppu_buffer);
+                WritePixelsIn(PPURasterTimings.border_bottom, RawFieldBuffer, pixel_index, scanline, pixel_threshold, blank_level, &ppu_buffer);
             }
 
         }
     }
     else {
-        for (uint16_t scanline = 0; scanline < PPURasterTimings.active_scanlines; scanline++) {
+        ppu_buffer = PPURawFrameBuffer + (size_t(line_start) * PPURasterTimings.active_pixels);
+        for (uint16_t scanline = uint16_t(line_start); scanline < std::min(line_end, int(PPURasterTimings.active_scanlines)); scanline++) {
             pixel_index = pixel_offset;
             // on PAL, syncless has no extra borders, so try not to write out of bounds
             if (PPUType == 0 && !PPUSyncEnable) pixel_index += PPURasterTimings.gray_pulse + PPURasterTimings.border_left;
             pixel_threshold = pixel_index;
             scanline_threshold = 0;
-            WritePixelsIn(PPURasterTimings.active_pixels, RawFieldBuffer, pixel_index, scanline, pixel_threshold, blank_level, &PPURawFrameBuffer);
+            WritePixelsIn(PPURasterTimings.active_pixels, RawFieldBuffer, pixel_index, scanline, pixel_threshold, blank_level, &ppu_buffer);
         }
     }
 }
 
-void NES_CVBS::WritePixelsIn(uint16_t length, PPUDotType* raw_field_buffer, uint16_t& pixel_index, uint16_t& scanline_index, uint16_t& pixel_threshold, PPUDotType pixel, uint16_t** ppu_buffer)
+void NES_CVBS::WritePixelsIn(uint16_t length, PPUDotType* raw_field_buffer, uint16_t& pixel_index, uint16_t& scanline_index, uint16_t& pixel_threshold, PPUDotType pixel, const uint16_t** ppu_buffer)
 {
     if (length <= 0) return;
     pixel_threshold += length;
@@ -279,7 +883,7 @@ bool NES_CVBS::ScanlineIsIn(uint16_t length, uint16_t& scanline, uint16_t& scanl
     return scanline < scanline_threshold;
 }
 
-void NES_CVBS::EncodeField(int dot_phase, int line_start, int line_end, bool skip_dot)
+void NES_CVBS::EncodeField(int dot_phase, int line_start, int line_end, bool skip_dot, int pixel_start, int pixel_end)
 {
     // TODO: find a more efficient method to determine color wave phase
     static auto in_phase = [&](uint16_t phase, uint8_t hue) {
@@ -296,14 +900,14 @@ void NES_CVBS::EncodeField(int dot_phase, int line_start, int line_end, bool ski
     static int phase_swing_delta = 3;
 
     // amount of color generator clocks within a given pixel
-    static int phase_pixel_delta = PPURasterTimings.samples_per_pixel;
+    int phase_pixel_delta = PPURasterTimings.samples_per_pixel;
 
     // skip a dot on odd rendered frames.
     // we can't really alter the size of the signal buffer, so instead we'll shift the phase by -1 pixel_index
     // we'll skip over this pixel in the decoder
     bool dot_jump = skip_dot && (PPUType == 0);
 
-    static int syncless_offset = PPURasterTimings.horizontal_sync +
+    int syncless_offset = PPURasterTimings.horizontal_sync +
         PPURasterTimings.back_porch_first +
         PPURasterTimings.colorburst +
         PPURasterTimings.back_porch_second;
@@ -327,6 +931,14 @@ void NES_CVBS::EncodeField(int dot_phase, int line_start, int line_end, bool ski
     if (dot_jump && line_start == 0 && PPUSyncEnable)
         phase = (phase + phase_pixel_delta) % 12;
 
+    // runs the color generator over dots without encoding them, same as stepping a dot at a time.
+    // a phase left negative by a skipped dot is stepped until % stops keeping the sign
+    auto advance_dots = [&](int dots) {
+        for (; dots > 0 && phase < 0; dots--)
+            phase = (phase + phase_pixel_delta) % 12;
+        phase = int8_t((phase + ((dots % 12) * phase_pixel_delta)) % 12);
+    };
+
     for (int scanline = line_start; scanline < line_end; scanline++) {
         if (!PPUSyncEnable) phase = (phase + syncless_offset) % 12;
         // on PAL, alternate phase on every other scanline
@@ -343,6 +955,17 @@ void NES_CVBS::EncodeField(int dot_phase, int line_start, int line_end, bool ski
             else if (dot_jump && pixel_index == 0 && scanline == 1 && !PPUSyncEnable)
                 phase = (phase + phase_pixel_delta) % 12;
 
+            // outside of the requested dots, only keep the color generator running.
+            // the whole run is skipped at once, except on the lines a dot can be skipped in
+            if (pixel_index < pixel_start || pixel_index >= pixel_end) {
+                int run_end = pixel_index < pixel_start ? pixel_start : FieldBufferWidth;
+                if (dot_jump && scanline <= 1)
+                    run_end = pixel_index + 1;
+                advance_dots(run_end - pixel_index);
+                pixel_index = run_end - 1;
+                continue;
+            }
+
             PPUDotType pixel = RawFieldBuffer[size_t((scanline * FieldBufferWidth) + pixel_index)];
             uint8_t color = pixel & 0x3F;
             uint8_t hue = pixel & 0x0F;
@@ -362,8 +985,9 @@ void NES_CVBS::EncodeField(int dot_phase, int line_start, int line_end, bool ski
                 wave_toggle = in_phase(phase, hue);
                 emphasis_toggle = in_emphasis_phase(phase, emphasis);
 
-                //if (pixel == sync_level) wave_toggle = 0;
-                //else if (pixel == blank_level) wave_toggle = 1;
+                // sync and blank are flat levels, so a sync separator can tell them apart
+                if (pixel == sync_level) wave_toggle = 0;
+                else if (pixel == blank_level) wave_toggle = 1;
 
                 SignalFieldBuffer[size_t((scanline * FieldBufferWidth * phase_pixel_delta) +
                     (pixel_index * phase_pixel_delta) +
@@ -372,11 +996,103 @@ void NES_CVBS::EncodeField(int dot_phase, int line_start, int line_end, bool ski
                 phase = (phase + 1) % 12;
             }
         }
+        // record the phase the decoder should demodulate this scanline with.
+        // taken at the end of the line, since a skipped dot only affects the start of it
+        SignalLinePhase[scanline] = uint8_t((((phase - SignalBufferWidth) % 12) + 12) % 12);
+        SignalLinePhaseOffset[scanline] = 0.0f;
+
         if (phase_alternate) phase = (phase - phase_swing_delta) % 12;
-        if (!PPUSyncEnable) phase = (phase + PPURasterTimings.front_porch - 2) % 12;
+        // syncless fields leave out part of the raster line, so run the color generator through the rest of it
+        if (!PPUSyncEnable) phase = (phase + ((PPURasterTimings.field_width - FieldBufferWidth) * phase_pixel_delta) - syncless_offset) % 12;
     }
 }
 
-void NES_CVBS::DecodeField(uint32_t* rgb_buffer, int dot_phase, int line_start, int line_end, bool skip_dot)
+int NES_CVBS::DecoderSampleStart(int pixel_index)
 {
+    return (pixel_index / DecoderKernelPhases) * DecoderKernelStride + DecoderKernelOffset[pixel_index % DecoderKernelPhases];
 }
+
+void NES_CVBS::DecodeLine(const uint16_t* signal_line, int line_phase, int pixel_start, int pixel_end, float* luma, float* chroma_u, float* chroma_v)
+{
+    int input_width = SignalBufferWidth;
+    int taps = DecoderKernelTaps;
+
+    for (int pixel_index = pixel_start; pixel_index < pixel_end; pixel_index++) {
+        int kernel_phase = pixel_index % DecoderKernelPhases;
+        int sample_start = DecoderSampleStart(pixel_index);
+        const float* kernel = &DecoderKernel[size_t(kernel_phase) * taps];
+        const float* carrier_u = &DecoderCarrierU[(((line_phase + sample_start) % 12) + 12) % 12];
+        const float* carrier_v = &DecoderCarrierV[(((line_phase + sample_start) % 12) + 12) % 12];
+
+        // resample luma and demodulate chroma in the same pass over the signal
+        float y = 0.0f, u = 0.0f, v = 0.0f;
+        if (sample_start >= 0 && sample_start + taps <= input_width) {
+            const uint16_t* signal = &signal_line[sample_start];
+            for (int tap = 0; tap < taps; tap++) {
+                float sample = kernel[tap] * float(signal[tap]);
+                y += sample;
+                u += sample * carrier_u[tap];
+                v += sample * carrier_v[tap];
+            }
+        }
+        else {
+            // clamp to the edges of the scanline
+            for (int tap = 0; tap < taps; tap++) {
+                float sample = kernel[tap] * float(signal_line[std::clamp(sample_start + tap, 0, input_width - 1)]);
+                y += sample;
+                u += sample * carrier_u[tap];
+                v += sample * carrier_v[tap];
+            }
+        }
+        luma[pixel_index] = (y - DecoderBlackLevel) * DecoderGain;
+        chroma_u[pixel_index] = u;
+        chroma_v[pixel_index] = v;
+    }
+}
+
+template <typename PixelWriter>
+void NES_CVBS::DecodeField(void* output_buffer, int line_start, int line_end, int pixel_start, int pixel_end)
+{
+    PixelWriter writer(output_buffer, OutputBufferWidth, OutputBufferHeight);
+
+    // one decoded scanline, kept hot in cache while it's stored into its output rows
+    std::vector<float> luma(OutputBufferWidth), chroma_u(OutputBufferWidth), chroma_v(OutputBufferWidth);
+
+    // on interlaced output, odd fields shift the row gains by half a scanline
+    int gain_rotation = OutputInterlace ? OutputFieldParity * (OutputRowsPerLine / 2) : 0;
+
+    for (int scanline = line_start; scanline < line_end; scanline++) {
+        DecodeLine(&DecoderSignalBuffer[size_t(scanline) * SignalBufferWidth], SignalLinePhase[scanline], pixel_start, pixel_end,
+            luma.data(), chroma_u.data(), chroma_v.data());
+
+        // the demodulation carriers only come in whole phases, rotate the chroma by the rest
+        float phase_offset = SignalLinePhaseOffset[scanline];
+        if (phase_offset != 0.0f) {
+            float angle = phase_offset * float(2 * 3.14159265358979323846 / 12);
+            float rotation_cos = std::cos(angle), rotation_sin = std::sin(angle);
+            for (int pixel_index = pixel_start; pixel_index < pixel_end; pixel_index++) {
+                float u = chroma_u[pixel_index], v = chroma_v[pixel_index];
+                chroma_u[pixel_index] = u * rotation_cos + v * rotation_sin;
+                chroma_v[pixel_index] = v * rotation_cos - u * rotation_sin;
+            }
+        }
+
+        for (int line_row = 0; line_row < OutputRowsPerLine; line_row++) {
+            size_t row = (size_t(scanline) * OutputRowsPerLine) + line_row;
+            float gain = OutputRowGains[(line_row + gain_rotation) % OutputRowsPerLine];
+
+            if (gain == 1.0f) {
+                for (int pixel_index = pixel_start; pixel_index < pixel_end; pixel_index++)
+                    writer.Write(row, pixel_index, luma[pixel_index], chroma_u[pixel_index], chroma_v[pixel_index]);
+            }
+            else {
+                // scaling YUV scales RGB equally, so the gain can be applied before the writer converts
+                for (int pixel_index = pixel_start; pixel_index < pixel_end; pixel_index++)
+                    writer.Write(row, pixel_index, luma[pixel_index] * gain, chroma_u[pixel_index] * gain, chroma_v[pixel_index] * gain);
+            }
+        }
+    }
+}
+
+// the benchmark harness drives the decoder on its own
+template void NES_CVBS::DecodeField<PixelWriterXRGB8888>(void* output_buffer, int line_start, int line_end, int pixel_start, int pixel_end);
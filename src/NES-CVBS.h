@@ -21,11 +21,17 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 
+#pragma once
+
 #include <cstdint>
 #include <vector>
 #include <thread>
+#include <string>
 #include "PPUVoltages.h"
 #include "PPUTimings.h"
+#include "PixelFormats.h"
+#include "FilterStats.h"
+#include "FilterTrace.h"
 
 enum PPUDotType {
     // first 512 entries are exclusively for the 9-bit PPU pixel format: "eeellcccc".
@@ -65,15 +71,28 @@ const uint8_t PaletteLUT_2C04[5][64] = {
 
 class NES_CVBS
 {
+    // times the individual filter stages
+    friend class NES_CVBS_Bench;
+
 private:
     PPUTimings PPURasterTimings = {};
 
+    // replaces the compiled-in voltages and timings of PPUType, see SetProfile()
+    bool PPUCustomProfile = false;
+    CompositeOutputLevel PPUCustomVoltages = {};
+    PPUTimings PPUCustomTimings = {};
+
     // Filter settings
     int PPUType = 0;                // 0 = 2C02, 1 = 2C07, 2 = UA6538
     int PPU2C04Rev = 0;             // for generating the LUT to unscramble 2C04 palettes
     bool PPUSyncEnable = false;     // enable sync and colorburst emulation
-    bool PPUFullFrameInput = false; // input buffer includes the entire 283x242 "visible portion". only available in NTSC
-    int PPUThreadCount = 0;         // enables multithreading when thread count > 1.
+    bool PPUFullFrameInput = false; // input buffer includes the entire visible_width x visible_height (283x242) "visible portion". only available in NTSC
+    int PPUThreadCount = 0;         // enables multithreading when thread count > 1. at most FilterStatsMaxWorkers
+    bool PPUThreadCountAuto = false;// recalibrate PPUThreadCount whenever the settings change
+    int PPUThreadCountMax = 0;      // highest thread count tried by the calibration, 0 = hardware threads
+
+    // ns per FilterFrame() at 1..n threads, from the last calibration
+    std::vector<uint64_t> ThreadScaling;
 
     // image settings
     double BrightnessDelta = 0.0;
@@ -81,6 +100,20 @@ private:
     double HueDelta = 0.0;
     double SaturationDelta = 0.0;
 
+    // requested output width, 0 = one output pixel per PPU dot
+    int OutputWidth = 0;
+    // output rows written per decoded scanline, and the gain of each of them
+    int OutputRowsPerLine = 1;
+    std::vector<float> OutputRowGains = { 1.0f };
+    bool OutputInterlace = false;
+    int OutputFieldParity = 0;
+
+    // timings and counters, always collected
+    FilterStatsCollector Stats;
+#ifdef NES_CVBS_TRACE
+    FilterTrace Trace;
+#endif
+
     // voltage LUT for any given color, in mV
     // low/high, no emphasis/emphasis, $xy color
     // 0x40 == sync, 0x41 = colorburst
@@ -89,41 +122,162 @@ private:
     // 2C04 unscrambling LUT
     const uint8_t* PPU2C04LUT = nullptr;
 
-    // input PPU frame buffer, can be 256x240 or 283x242
-    uint16_t* PPURawFrameBuffer = nullptr;
+    // input PPU frame buffer, can be 256x240 or visible_width x visible_height (283x242 with the compiled-in timings)
+    const uint16_t* PPURawFrameBuffer = nullptr;
 
+    // signal field the decoder reads: SignalFieldBuffer, or an external field given to DecodeSignal()
+    const uint16_t* DecoderSignalBuffer = nullptr;
+    // decoder black level and luma gain, in signal units
+    float DecoderBlackLevel = 0.0f;
+    float DecoderGain = 0.0f;
+    // U/V demodulation carriers for each color generator phase, repeated past 12 entries
+    // so the kernel can index (phase + tap) without wrapping
+    std::vector<float> DecoderCarrierU;
+    std::vector<float> DecoderCarrierV;
+    // polyphase resampling kernel: box filter over one subcarrier cycle convolved with a tent
+    // one row of DecoderKernelTaps weights per output phase
+    std::vector<float> DecoderKernel;
+    // first input sample of each output phase, relative to the start of its phase cycle
+    std::vector<int> DecoderKernelOffset;
+    int DecoderKernelTaps = 0;
+    // output pixels per phase cycle, and input samples per phase cycle
+    int DecoderKernelPhases = 0;
+    int DecoderKernelStride = 0;
+    // colorburst correlator: first sample of the window, and the subcarrier over it
+    int DecoderBurstStart = 0;
+    std::vector<float> DecoderBurstCos;
+    std::vector<float> DecoderBurstSin;
+    // take the line phases from the encoded colorburst instead of the encoder
+    bool DecoderBurstLock = false;
+
+    // where generated tables are cached, empty = no cache. see TableCache.h
+    static std::string TableCacheDirectory;
+    uint64_t TableCacheKey(const CompositeOutputLevel& ppu_voltages) const;
+    // fills the LUT and decoder tables from the cache file of key, false if there's none or it's stale
+    bool LoadTables(uint64_t key);
+    void SaveTables(uint64_t key) const;
+
+
+    // the kernel's phases, stride, taps and offsets, and the burst correlator's span, from the buffer widths and timings
+    void InitializeDecoderLayout();
 
     void InitializeSignalLevelLUT(double brightness_delta, double contrast_delta, CompositeOutputLevel ppu_voltages);
 
-    void InitializeDecoder(double hue_delta, double saturation_delta);
+    void InitializeDecoder(double hue_delta, double saturation_delta, CompositeOutputLevel ppu_voltages);
 
     // Initializes the raw field buffer
     void InitializeField();
 
-    // places the input PPU buffer into the raw field
-    void EmplaceField();
+    // places scanlines [line_start, line_end) of the input PPU buffer into the raw field
+    void EmplaceField(int line_start, int line_end);
 
     // helper functions for the two functions above
-    void WritePixelsIn(uint16_t length, PPUDotType* raw_field_buffer, uint16_t& pixel_index, uint16_t& scanline_index, uint16_t& pixel_threshold, PPUDotType pixel, uint16_t** ppu_buffer = nullptr);
+    void WritePixelsIn(uint16_t length, PPUDotType* raw_field_buffer, uint16_t& pixel_index, uint16_t& scanline_index, uint16_t& pixel_threshold, PPUDotType pixel, const uint16_t** ppu_buffer = nullptr);
     bool ScanlineIsIn(uint16_t length, uint16_t& scanline, uint16_t& scanline_threshold);
 
-    void EncodeField(int dot_phase, int line_start, int line_end, bool skip_dot);
-    void DecodeField(uint32_t* rgb_buffer, int dot_phase, int line_start, int line_end, bool skip_dot);
+    // encodes dots [pixel_start, pixel_end) of each scanline
+    void EncodeField(int dot_phase, int line_start, int line_end, bool skip_dot, int pixel_start, int pixel_end);
+    // first signal sample the decoder reads for an output pixel
+    int DecoderSampleStart(int pixel_index);
+    // measures the colorburst phase of lines [line_start, line_end) and runs a PLL across them,
+    // filling SignalLinePhase and SignalLinePhaseOffset
+    void TrackBurst(const uint16_t* signal_field, int line_start, int line_end);
+    // resamples and demodulates output pixels [pixel_start, pixel_end) of a single signal scanline into YUV
+    void DecodeLine(const uint16_t* signal_line, int line_phase, int pixel_start, int pixel_end, float* luma, float* chroma_u, float* chroma_v);
+    template <typename PixelWriter>
+    void DecodeField(void* output_buffer, int line_start, int line_end, int pixel_start, int pixel_end);
+
+    // encodes and decodes an area of the emplaced field, split across PPUThreadCount threads.
+    // only the dots the decoder needs for output columns [pixel_start, pixel_end) are encoded
+    template <typename PixelWriter>
+    void FilterField(void* output_buffer, int dot_phase, bool skip_dot, int line_start, int line_end, int pixel_start, int pixel_end);
+    void FilterFieldAs(PixelFormat pixel_format, void* output_buffer, int dot_phase, bool skip_dot, int line_start, int line_end, int pixel_start, int pixel_end);
+    void CountFrame(bool skip_dot, int lines_skipped, uint64_t frame_ns);
 
 public:
     uint16_t FieldBufferWidth = 0;
     uint16_t FieldBufferHeight = 0;
     uint16_t SignalBufferWidth = 0;
     uint16_t SignalBufferHeight = 0;
+    // decoded RGB output is OutputBufferWidth x OutputBufferHeight
+    uint16_t OutputBufferWidth = 0;
+    uint16_t OutputBufferHeight = 0;
     // entire raw PPU pixel field is stored here, for encoding later
     PPUDotType* RawFieldBuffer = nullptr;
     // a single composite field is stored here for color decoding
     uint16_t* SignalFieldBuffer = nullptr;
+    // color generator phase of the first sample of each signal scanline
+    uint8_t* SignalLinePhase = nullptr;
+    // fraction of a phase to add to SignalLinePhase, from the burst PLL. 0 for encoded lines
+    float* SignalLinePhaseOffset = nullptr;
 
-    void FilterFrame(uint16_t* ppu_buffer, uint32_t* rgb_buffer, int dot_phase, bool skip_dot);
+    void FilterFrame(const uint16_t* ppu_buffer, uint32_t* rgb_buffer, int dot_phase, bool skip_dot);
+    // same as above, but writes the output in any PixelFormat.
+    // output_buffer must hold PixelBufferSize(pixel_format, OutputBufferWidth, OutputBufferHeight) bytes
+    void FilterFrame(const uint16_t* ppu_buffer, void* output_buffer, PixelFormat pixel_format, int dot_phase, bool skip_dot);
+    // filters only the dots [x, x + width) of scanlines [y, y + height) of the field, plus what the decoder
+    // needs around them. the output buffer is the same full size buffer as FilterFrame(), and only
+    // the covered output pixels are written
+    void FilterRegion(const uint16_t* ppu_buffer, uint32_t* rgb_buffer, int dot_phase, bool skip_dot, int x, int y, int width, int height);
+    void FilterRegion(const uint16_t* ppu_buffer, void* output_buffer, PixelFormat pixel_format, int dot_phase, bool skip_dot, int x, int y, int width, int height);
+    // decodes an externally supplied signal field in place of EncodeField()'s output, e.g. a capture
+    // resampled to the color generator clock. the field is SignalBufferWidth x SignalBufferHeight samples
+    // at SignalFieldBuffer's levels, e.g. from a dump opened with SignalDumpReader::Open(filename, filter). with sync enabled, the line phases are detected from the colorburst,
+    // otherwise they follow dot_phase and skip_dot the same way the encoder's do
+    void DecodeSignal(const uint16_t* signal_field, uint32_t* rgb_buffer, int dot_phase, bool skip_dot);
+    void DecodeSignal(const uint16_t* signal_field, void* output_buffer, PixelFormat pixel_format, int dot_phase, bool skip_dot);
+    // fills SignalLinePhase and SignalLinePhaseOffset from the colorburst of each line of a signal field,
+    // through a PLL that carries the phase over lines without a burst.
+    // returns false without sync, where there is no colorburst to detect
+    bool DetectLinePhase(const uint16_t* signal_field);
+    // writes a signal field (SignalFieldBuffer if none is given) as 16-bit big-endian samples, the byte order
+    // of 16-bit PNGs. big_endian_buffer must hold SignalBufferWidth x SignalBufferHeight x 2 bytes
+    void ExportSignalField(uint8_t* big_endian_buffer, const uint16_t* signal_field = nullptr) const;
+    // writes the RGB color of the first color_count 9-bit "eeellcccc" pixels (64 colors, or 512 with emphasis)
+    // as seen through the current settings, by encoding and decoding a flat field of each. 3 bytes per color
+    void GeneratePalette(uint8_t* palette, int color_count = 512);
     // initializes the signal LUT, decoder and encoder. call before applying FilterFrame()
     void ApplySettings(double brightness_delta, double contrast_delta, double hue_delta, double saturation_delta);
+    // rolling min/mean/p99 stage timings, per worker busy/idle time and frame counters.
+    // safe to call from any thread while another one is filtering
+    FilterStats GetStats() const;
+    void ResetStats();
+    // writes the recorded stage events as a Chrome trace JSON file and clears them.
+    // call between frames. returns false if the file can't be written, or in builds without NES_CVBS_TRACE
+    bool WriteTrace(const char* filename);
+    // times FilterFrame() on a synthetic frame in the current mode at 1..max_thread_count threads
+    // (0 = hardware threads) and switches to the fastest. returns the ns per frame of each thread count.
+    // the calibration frames aren't counted in the stats or recorded in the trace
+    const std::vector<uint64_t>& CalibrateThreadCount(int max_thread_count = 0, int iterations = 8);
+    // with enable, calibrates now and again every time the settings change
+    void SetAutoThreadCount(bool enable, int max_thread_count = 0);
+    int GetThreadCount() const;
+    int GetPPUType() const;
+    const PPUTimings& GetTimings() const;
+    // halfway between the sync tip and blank levels of SignalLevelLUT
+    uint16_t GetSyncThreshold() const;
+    const std::vector<uint64_t>& GetThreadScaling() const;
+    // with sync enabled, FilterFrame() and FilterRegion() decode with the phases of the encoded colorburst
+    // instead of trusting dot_phase
+    void SetBurstLock(bool enable);
+    // resizes the decoded output. 0 = one pixel per PPU dot
+    void SetOutputWidth(int output_width);
+    // writes each decoded scanline into rows_per_line output rows, each scaled by its row_gains entry.
+    // gains above 1.0 overdrive the row for bloom, and are clipped by the pixel writer.
+    // with interlace, every other FilterFrame() rotates the gains by half a scanline
+    void SetScanlineRows(int rows_per_line, const std::vector<float>& row_gains, bool interlace);
+
+    // runs the filter on other voltages and timings than the compiled-in ones of its PPU type,
+    // e.g. from a PPUProfile file. they're expected to be validated already (PPUProfile::Load() does)
+    void SetProfile(const CompositeOutputLevel& voltages, const PPUTimings& timings);
+    // back to the compiled-in profile
+    void ResetProfile();
+
+    // caches the generated LUT and decoder tables in a directory, one file per settings hash.
+    // ApplySettings() maps them from there, or generates them and writes the file when it's missing or stale.
+    // nullptr or "" turns the cache off. call before creating filters, it's shared by all of them
+    static void SetTableCacheDirectory(const char* directory);
 
-    NES_CVBS(int ppu_type, int ppu_2c04_rev, bool ppu_sync_enable, bool ppu_full_frame_input, int ppu_thread_count);
+    NES_CVBS(int ppu_type, int ppu_2c04_rev, bool ppu_sync_enable, bool ppu_full_frame_input, int ppu_thread_count, int output_width = 0);
     ~NES_CVBS();
 };
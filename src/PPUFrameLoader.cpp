@@ -0,0 +1,136 @@
+/*
+NES-CVBS
+Copyright (c) 2023 Persune
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "PPUFrameLoader.h"
+#include <cstring>
+#include <fstream>
+
+PPUFrameLoader::PPUFrameLoader()
+{
+    // keep the PNG's own palette indices, and skip checksums since test corpora are trusted local files
+    PNGState.decoder.color_convert = 0;
+    PNGState.decoder.ignore_crc = 1;
+    PNGState.decoder.zlibsettings.ignore_adler32 = 1;
+}
+
+bool PPUFrameLoader::Load(const char* filename, uint16_t* ppu_frame, int width, int height, const char* emphasis_filename)
+{
+    size_t pixels = size_t(width) * height;
+    if (!DecodeIndices(filename, width, height))
+        return false;
+    for (size_t pixel = 0; pixel < pixels; pixel++)
+        ppu_frame[pixel] = Indices[pixel] & 0x3F;
+
+    if (emphasis_filename != nullptr) {
+        if (!DecodeIndices(emphasis_filename, width, height))
+            return false;
+        for (size_t pixel = 0; pixel < pixels; pixel++)
+            ppu_frame[pixel] |= uint16_t((Indices[pixel] & 0x07) << 6);
+    }
+    return true;
+}
+
+bool PPUFrameLoader::DecodeIndices(const char* filename, int width, int height)
+{
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file)
+        return false;
+    FileData.resize(size_t(file.tellg()));
+    file.seekg(0);
+    if (!file.read((char*)FileData.data(), std::streamsize(FileData.size())))
+        return false;
+
+    if (FileData.size() >= 8 && std::memcmp(FileData.data(), "\x89PNG", 4) == 0)
+        return DecodePNG(width, height);
+    if (FileData.size() >= 2 && FileData[0] == 'B' && FileData[1] == 'M')
+        return DecodeBMP(width, height);
+    return false;
+}
+
+bool PPUFrameLoader::DecodePNG(int width, int height)
+{
+    std::vector<unsigned char> raw;
+    unsigned png_width = 0, png_height = 0;
+    if (lodepng::decode(raw, png_width, png_height, PNGState, FileData) != 0)
+        return false;
+    const LodePNGColorMode& color = PNGState.info_png.color;
+    if (color.colortype != LCT_PALETTE || int(png_width) != width || int(png_height) != height)
+        return false;
+
+    // lodepng packs indices under 8 bits tightly, without padding at the end of the rows
+    size_t pixels = size_t(width) * height;
+    unsigned bit_depth = color.bitdepth;
+    Indices.resize(pixels);
+    if (bit_depth == 8) {
+        std::memcpy(Indices.data(), raw.data(), pixels);
+        return true;
+    }
+    unsigned mask = (1u << bit_depth) - 1;
+    for (size_t pixel = 0; pixel < pixels; pixel++) {
+        size_t bit = pixel * bit_depth;
+        Indices[pixel] = uint8_t((raw[bit >> 3] >> (8 - bit_depth - (bit & 7))) & mask);
+    }
+    return true;
+}
+
+bool PPUFrameLoader::DecodeBMP(int width, int height)
+{
+    auto read16 = [&](size_t offset) { return uint32_t(FileData[offset] | (FileData[offset + 1] << 8)); };
+    auto read32 = [&](size_t offset) { return read16(offset) | (read16(offset + 2) << 16); };
+
+    // BITMAPFILEHEADER, then at least a BITMAPINFOHEADER
+    if (FileData.size() < 54)
+        return false;
+    uint32_t pixel_offset = read32(10);
+    int32_t bmp_width = int32_t(read32(18));
+    int32_t bmp_height = int32_t(read32(22));
+    uint32_t bit_depth = read16(28);
+    uint32_t compression = read32(30);
+
+    // rows are stored bottom up, unless the height is negative
+    bool top_down = bmp_height < 0;
+    if (top_down) bmp_height = -bmp_height;
+    if (compression != 0 || bmp_width != width || bmp_height != height || (bit_depth != 1 && bit_depth != 4 && bit_depth != 8))
+        return false;
+
+    // rows are padded to 4 bytes
+    size_t row_size = ((size_t(width) * bit_depth + 31) / 32) * 4;
+    if (pixel_offset + row_size * height > FileData.size())
+        return false;
+
+    unsigned mask = (1u << bit_depth) - 1;
+    Indices.resize(size_t(width) * height);
+    for (int row = 0; row < height; row++) {
+        const uint8_t* source = &FileData[pixel_offset + row_size * size_t(top_down ? row : height - 1 - row)];
+        uint8_t* indices = &Indices[size_t(row) * width];
+        if (bit_depth == 8) {
+            std::memcpy(indices, source, size_t(width));
+            continue;
+        }
+        for (int column = 0; column < width; column++) {
+            size_t bit = size_t(column) * bit_depth;
+            indices[column] = uint8_t((source[bit >> 3] >> (8 - bit_depth - (bit & 7))) & mask);
+        }
+    }
+    return true;
+}
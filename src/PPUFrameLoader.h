@@ -0,0 +1,53 @@
+/*
+NES-CVBS
+Copyright (c) 2023 Persune
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+// loads palette indexed PNG and BMP test frames straight into the 9-bit "eeellcccc" pixels FilterFrame() takes.
+// each palette index is a PPU color (index & 0x3F), the palette's own colors are ignored.
+// emphasis can come from a side channel image of the same size, whose indices are the 3 emphasis bits
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "lodepng/lodepng.h"
+
+class PPUFrameLoader
+{
+private:
+    // reused between loads, so a corpus doesn't allocate per frame
+    lodepng::State PNGState;
+    std::vector<uint8_t> FileData;
+    std::vector<uint8_t> Indices;
+
+    // indices of a PNG or BMP file in FileData, one byte per pixel
+    bool DecodeIndices(const char* filename, int width, int height);
+    bool DecodePNG(int width, int height);
+    bool DecodeBMP(int width, int height);
+
+public:
+    // ppu_frame holds width x height pixels. the image has to be exactly that size
+    bool Load(const char* filename, uint16_t* ppu_frame, int width, int height, const char* emphasis_filename = nullptr);
+
+    PPUFrameLoader();
+};
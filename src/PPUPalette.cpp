@@ -0,0 +1,71 @@
+/*
+NES-CVBS
+Copyright (c) 2023 Persune
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "PPUPalette.h"
+#include "NES-CVBS.h"
+#include <fstream>
+
+void PPUPalette::Generate(NES_CVBS& filter, bool emphasis)
+{
+    Colors = emphasis ? 512 : 64;
+    filter.GeneratePalette(Entries, Colors);
+}
+
+bool PPUPalette::Save(const char* filename) const
+{
+    if (Colors == 0)
+        return false;
+    std::ofstream file(filename, std::ios::binary);
+    return bool(file.write((const char*)Entries, std::streamsize(Colors * 3)));
+}
+
+bool PPUPalette::Load(const char* filename)
+{
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file)
+        return false;
+    size_t size = size_t(file.tellg());
+    if (size != 64 * 3 && size != 512 * 3)
+        return false;
+    file.seekg(0);
+    if (!file.read((char*)Entries, std::streamsize(size)))
+        return false;
+    Colors = int(size / 3);
+    return true;
+}
+
+uint32_t PPUPalette::XRGB(uint16_t pixel) const
+{
+    const uint8_t* entry = &Entries[size_t(pixel & (Colors == 512 ? 0x1FF : 0x3F)) * 3];
+    return 0xFF000000 | (uint32_t(entry[0]) << 16) | (uint32_t(entry[1]) << 8) | uint32_t(entry[2]);
+}
+
+void PPUPalette::Apply(const uint16_t* ppu_buffer, uint32_t* rgb_buffer, size_t pixel_count) const
+{
+    // one lookup table per call, pixels are only 9 bits
+    uint32_t colors[512];
+    for (int pixel = 0; pixel < 512; pixel++)
+        colors[pixel] = XRGB(uint16_t(pixel));
+    for (size_t index = 0; index < pixel_count; index++)
+        rgb_buffer[index] = colors[ppu_buffer[index] & 0x1FF];
+}
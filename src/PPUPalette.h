@@ -0,0 +1,54 @@
+/*
+NES-CVBS
+Copyright (c) 2023 Persune
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+// .pal palette files, as read by most NES emulators: RGB triplets of the 64 PPU colors (192 bytes),
+// or of all 512 color and emphasis combinations in "eeellcccc" pixel order (1536 bytes).
+// a palette generated once from the composite model lets a client color frames without running the filter
+
+#include <cstdint>
+#include <cstddef>
+
+class NES_CVBS;
+
+class PPUPalette
+{
+private:
+    uint8_t Entries[512 * 3] = {};
+    int Colors = 0;
+
+public:
+    // 64 or 512 colors from the filter's current settings, see NES_CVBS::GeneratePalette()
+    void Generate(NES_CVBS& filter, bool emphasis = true);
+    bool Save(const char* filename) const;
+    // fails on anything but a 192 or 1536 byte file
+    bool Load(const char* filename);
+
+    int ColorCount() const { return Colors; }
+    const uint8_t* Data() const { return Entries; }
+    // 0xFFRRGGBB of a 9-bit PPU pixel. with only 64 colors, the emphasis bits are ignored
+    uint32_t XRGB(uint16_t pixel) const;
+    // colors a whole frame of PPU pixels
+    void Apply(const uint16_t* ppu_buffer, uint32_t* rgb_buffer, size_t pixel_count) const;
+};
@@ -0,0 +1,257 @@
+/*
+NES-CVBS
+Copyright (c) 2023 Persune
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "PPUProfile.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <vector>
+
+static const char* PPUTypeNames[3] = { "2c02", "2c07", "ua6538" };
+
+static const struct {
+    const char* name;
+    uint16_t PPUTimings::* field;
+} PPUTimingFields[] = {
+    { "field_width", &PPUTimings::field_width },
+    { "field_height", &PPUTimings::field_height },
+    { "visible_width", &PPUTimings::visible_width },
+    { "visible_height", &PPUTimings::visible_height },
+    { "horizontal_sync", &PPUTimings::horizontal_sync },
+    { "back_porch_first", &PPUTimings::back_porch_first },
+    { "colorburst_length", &PPUTimings::colorburst },
+    { "back_porch_second", &PPUTimings::back_porch_second },
+    { "front_porch", &PPUTimings::front_porch },
+    { "active_scanlines", &PPUTimings::active_scanlines },
+    { "gray_pulse", &PPUTimings::gray_pulse },
+    { "border_left", &PPUTimings::border_left },
+    { "active_pixels", &PPUTimings::active_pixels },
+    { "border_right", &PPUTimings::border_right },
+    { "postrender_scanlines", &PPUTimings::postrender_scanlines },
+    { "border_bottom", &PPUTimings::border_bottom },
+    { "postrender_blank_scanlines", &PPUTimings::postrender_blank_scanlines },
+    { "vblank", &PPUTimings::vblank },
+    { "vertical_sync_scanlines", &PPUTimings::vertical_sync_scanlines },
+    { "blank_pulse", &PPUTimings::blank_pulse },
+    { "sync_seperator", &PPUTimings::sync_seperator },
+    { "prerender_blanking_scanlines", &PPUTimings::prerender_blanking_scanlines },
+    { "samples_per_pixel", &PPUTimings::samples_per_pixel },
+};
+
+void PPUProfile::SetBuiltin(int ppu_type)
+{
+    switch (ppu_type) {
+    case 1:
+        Voltages = NES_2C07;
+        Timings = PPU2C07Timings;
+        break;
+    case 2:
+        Voltages = NES_UA6538;
+        Timings = PPUUA6538Timings;
+        break;
+    default:
+        ppu_type = 0;
+        Voltages = NES_2C02;
+        Timings = PPU2C02Timings;
+        break;
+    }
+    PPUType = ppu_type;
+}
+
+bool PPUProfile::Fail(int line, const std::string& message)
+{
+    ErrorMessage = line > 0 ? "line " + std::to_string(line) + ": " + message : message;
+    return false;
+}
+
+bool PPUProfile::Load(const char* filename)
+{
+    std::ifstream file(filename);
+    if (!file)
+        return Fail(0, std::string("can't open ") + filename);
+
+    // parsed into a copy, so a bad file leaves the current profile alone
+    PPUProfile profile;
+    bool has_values = false;
+    std::string text;
+    for (int line = 1; std::getline(file, text); line++) {
+        text = text.substr(0, text.find('#'));
+        std::istringstream words(text);
+        std::vector<std::string> tokens{ std::istream_iterator<std::string>(words), std::istream_iterator<std::string>() };
+        if (tokens.empty())
+            continue;
+
+        const std::string& key = tokens[0];
+        std::vector<double> values;
+        if (key != "ppu") {
+            for (size_t i = 1; i < tokens.size(); i++) {
+                char* end = nullptr;
+                double value = std::strtod(tokens[i].c_str(), &end);
+                if (*end != '\0' || !std::isfinite(value))
+                    return Fail(line, "\"" + tokens[i] + "\" is not a number");
+                values.push_back(value);
+            }
+        }
+        auto expect = [&](size_t count) {
+            return tokens.size() - 1 == count || Fail(line, key + " takes " + std::to_string(count) + " value(s)");
+        };
+
+        if (key == "ppu") {
+            // must come first, it resets everything to that PPU's compiled-in profile
+            if (!expect(1))
+                return false;
+            if (has_values)
+                return Fail(line, "ppu has to come before the values");
+            int ppu_type = 0;
+            while (ppu_type < 3 && tokens[1] != PPUTypeNames[ppu_type])
+                ppu_type++;
+            if (ppu_type == 3)
+                return Fail(line, "unknown ppu " + tokens[1] + ", expected 2c02, 2c07 or ua6538");
+            profile.SetBuiltin(ppu_type);
+            continue;
+        }
+        has_values = true;
+        if (key == "sync" || key == "colorburst") {
+            if (!expect(2))
+                return false;
+            double* levels = key == "sync" ? profile.Voltages.sync : profile.Voltages.colorburst;
+            levels[0] = values[0];
+            levels[1] = values[1];
+        }
+        else if (key == "signal") {
+            if (!expect(5))
+                return false;
+            if (values[0] != std::floor(values[0]) || values[0] < 0 || values[0] > 3)
+                return Fail(line, "signal luma must be 0 to 3");
+            double (&levels)[2][2] = profile.Voltages.signal[int(values[0])];
+            levels[0][0] = values[1];
+            levels[0][1] = values[2];
+            levels[1][0] = values[3];
+            levels[1][1] = values[4];
+        }
+        else {
+            if (!expect(1))
+                return false;
+            double value = values[0];
+            if (value != std::floor(value) || value < 0 || value > 0xFFFF)
+                return Fail(line, key + " must be a whole number from 0 to 65535");
+
+            if (key == "dot_skip") {
+                if (value > 1)
+                    return Fail(line, "dot_skip must be 0 or 1");
+                profile.Timings.dot_skip = value != 0;
+            }
+            else if (key == "colorburst_phase") {
+                if (value > 11)
+                    return Fail(line, "colorburst_phase must be 0 to 11");
+                profile.Timings.colorburst_phase = uint8_t(value);
+            }
+            else {
+                auto timing = std::find_if(std::begin(PPUTimingFields), std::end(PPUTimingFields),
+                    [&](const auto& field) { return key == field.name; });
+                if (timing == std::end(PPUTimingFields))
+                    return Fail(line, "unknown key " + key);
+                profile.Timings.*(timing->field) = uint16_t(value);
+            }
+        }
+    }
+
+    if (!profile.Validate())
+        return Fail(0, profile.ErrorMessage);
+    *this = profile;
+    return true;
+}
+
+bool PPUProfile::Validate()
+{
+    const CompositeOutputLevel& v = Voltages;
+    // the LUT maps sync tip..white to 0..0xFFFF, every other level has to land in between
+    double sync_tip = v.sync[0], white = v.signal[3][1][0];
+    if (!(v.sync[1] > sync_tip && white > v.sync[1]))
+        return Fail(0, "voltages must rise from sync to blank to white ($30)");
+    for (double level : { v.colorburst[0], v.colorburst[1] })
+        if (level < sync_tip || level > white)
+            return Fail(0, "colorburst is outside sync..white");
+    for (int luma = 0; luma < 4; luma++)
+        for (int high = 0; high < 2; high++)
+            for (int emph = 0; emph < 2; emph++)
+                if (v.signal[luma][high][emph] < sync_tip || v.signal[luma][high][emph] > white)
+                    return Fail(0, "signal " + std::to_string(luma) + " is outside sync..white");
+
+    const PPUTimings& t = Timings;
+    // the raster is written segment by segment, so the segments have to add up to the buffers
+    int line_width = t.horizontal_sync + t.back_porch_first + t.colorburst + t.back_porch_second + t.front_porch;
+    int picture_width = t.gray_pulse + t.border_left + t.active_pixels + t.border_right;
+    int field_height = t.active_scanlines + t.postrender_scanlines + t.postrender_blank_scanlines +
+        t.vertical_sync_scanlines + t.prerender_blanking_scanlines;
+    if (t.active_pixels != 256 || t.active_scanlines != 240)
+        return Fail(0, "active_pixels and active_scanlines must be 256 and 240, the size of a PPU frame");
+    if (t.horizontal_sync == 0 || t.colorburst == 0)
+        return Fail(0, "horizontal_sync and colorburst_length can't be 0");
+    if (line_width + picture_width != t.field_width)
+        return Fail(0, "field_width must be the sum of the horizontal segments (" + std::to_string(line_width + picture_width) + ")");
+    if (field_height != t.field_height)
+        return Fail(0, "field_height must be the sum of the scanline counts (" + std::to_string(field_height) + ")");
+    if (t.gray_pulse + t.border_bottom != picture_width || t.vblank != picture_width)
+        return Fail(0, "gray_pulse + border_bottom and vblank must span the picture (" + std::to_string(picture_width) + ")");
+    if (t.blank_pulse + t.sync_seperator + t.front_porch != t.field_width)
+        return Fail(0, "blank_pulse + sync_seperator + front_porch must be field_width");
+    if (t.visible_height != t.active_scanlines + t.postrender_scanlines)
+        return Fail(0, "visible_height must be active_scanlines + postrender_scanlines");
+    // NTSC fields keep their borders without sync, PAL ones are cropped to the active picture
+    if (PPUType == 0 && t.visible_width != picture_width)
+        return Fail(0, "visible_width of a 2c02 must span the picture (" + std::to_string(picture_width) + ")");
+    if (PPUType != 0 && (t.visible_width != t.active_pixels || t.postrender_scanlines != 0))
+        return Fail(0, "visible_width of a 2c07 or ua6538 must be active_pixels, with no postrender_scanlines");
+    if (t.samples_per_pixel == 0 || t.field_width * t.samples_per_pixel > 0xFFFF)
+        return Fail(0, "samples_per_pixel must be at least 1, and field_width x samples_per_pixel at most 65535");
+    return true;
+}
+
+bool PPUProfile::Save(const char* filename) const
+{
+    std::ofstream file(filename);
+    if (!file)
+        return false;
+
+    // shortest text that reads back as the same double, so a saved profile loads into the same tables
+    auto number = [](double value) {
+        char text[32];
+        return std::string(text, std::to_chars(text, text + sizeof(text), value).ptr);
+    };
+    const CompositeOutputLevel& v = Voltages;
+    file << "# NES-CVBS PPU profile\nppu " << PPUTypeNames[PPUType] << "\n";
+    file << "sync " << number(v.sync[0]) << " " << number(v.sync[1]) << "\n";
+    file << "colorburst " << number(v.colorburst[0]) << " " << number(v.colorburst[1]) << "\n";
+    for (int luma = 0; luma < 4; luma++)
+        file << "signal " << luma << " " << number(v.signal[luma][0][0]) << " " << number(v.signal[luma][0][1]) << " " <<
+            number(v.signal[luma][1][0]) << " " << number(v.signal[luma][1][1]) << "\n";
+    for (const auto& timing : PPUTimingFields)
+        file << timing.name << " " << Timings.*(timing.field) << "\n";
+    file << "dot_skip " << int(Timings.dot_skip) << "\ncolorburst_phase " << int(Timings.colorburst_phase) << "\n";
+    return bool(file.flush());
+}
@@ -0,0 +1,68 @@
+/*
+NES-CVBS
+Copyright (c) 2023 Persune
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+// PPU profiles: the composite voltages and raster timings of a PPU, loaded from a text file at runtime
+// instead of the compiled-in NES_2C02/PPU2C02Timings etc. one "key values..." per line, # starts a comment:
+//
+//   ppu 2c02                          # 2c02, 2c07 or ua6538, the compiled-in profile the rest starts from
+//   sync 0.048 0.312                  # sync, blank
+//   colorburst 0.148 0.524            # low, high
+//   signal 0 0.228 0.192 0.616 0.500  # luma $0x-$3x: $xD, $xD emphasized, $x0, $x0 emphasized
+//   field_width 341                   # any PPUTimings field, dot_skip is 0 or 1.
+//                                     # the colorburst timing is colorburst_length
+//
+// keys that are left out keep the value of the ppu's compiled-in profile, so the same values
+// give the same filter tables as the compiled-in profile. Save() writes every key
+
+#include <cstdint>
+#include <string>
+#include "PPUVoltages.h"
+#include "PPUTimings.h"
+
+class PPUProfile
+{
+private:
+    int PPUType = 0;
+    CompositeOutputLevel Voltages = NES_2C02;
+    PPUTimings Timings = PPU2C02Timings;
+    std::string ErrorMessage;
+
+    bool Fail(int line, const std::string& message);
+    // the checks the encoder relies on to stay inside its buffers, and the LUT to stay in range
+    bool Validate();
+
+public:
+    // the compiled-in profile of a PPU type, 0 = 2C02, 1 = 2C07, 2 = UA6538
+    void SetBuiltin(int ppu_type);
+    // parses and validates a profile. on failure, the profile is left unchanged and Error() says why
+    bool Load(const char* filename);
+    bool Save(const char* filename) const;
+
+    // the filter has to be created with this PPU type, it decides the line phase alternation and dot skip
+    int GetPPUType() const { return PPUType; }
+    const CompositeOutputLevel& GetVoltages() const { return Voltages; }
+    const PPUTimings& GetTimings() const { return Timings; }
+    const std::string& Error() const { return ErrorMessage; }
+};
@@ -0,0 +1,56 @@
+/*
+NES-CVBS
+Copyright (c) 2023 Persune
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "PPUTraceReader.h"
+
+bool PPUTraceReader::Open(const char* filename, int width, int height)
+{
+    Close();
+    if (width <= 0 || height <= 0 || !File.Open(filename, mapped_read))
+        return false;
+
+    FrameSize = size_t(width) * height;
+    Frames = File.Size() / (FrameSize * sizeof(uint16_t));
+    if (Frames == 0) {
+        Close();
+        return false;
+    }
+    // traces are filtered front to back, let the OS read ahead of the page faults
+    File.AdviseSequential();
+    return true;
+}
+
+void PPUTraceReader::Close()
+{
+    File.Close();
+    FrameSize = 0;
+    Frames = 0;
+}
+
+const uint16_t* PPUTraceReader::Frame(size_t index) const
+{
+    if (index >= Frames)
+        return nullptr;
+    // mappings are page aligned and frames are a whole number of pixels, so this is aligned
+    return (const uint16_t*)File.Data() + (index * FrameSize);
+}
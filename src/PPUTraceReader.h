@@ -0,0 +1,47 @@
+/*
+NES-CVBS
+Copyright (c) 2023 Persune
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+// raw PPU frame traces: width x height little-endian uint16_t pixels per frame, frames back to back.
+// the trace is memory-mapped, so frames go to FilterFrame() by pointer without being copied
+
+#include <cstdint>
+#include <cstddef>
+#include "MappedFile.h"
+
+class PPUTraceReader
+{
+private:
+    MappedFile File;
+    size_t FrameSize = 0;   // pixels per frame
+    size_t Frames = 0;
+
+public:
+    // trailing bytes short of a whole frame are ignored. fails when there isn't a single frame
+    bool Open(const char* filename, int width, int height);
+    void Close();
+    size_t FrameCount() const { return Frames; }
+    // points into the mapping, valid until Close(). safe to call from any thread
+    const uint16_t* Frame(size_t index) const;
+};
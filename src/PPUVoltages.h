@@ -21,6 +21,8 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 
+#pragma once
+
 // NES composite output voltages, in volt units
 struct CompositeOutputLevel{
     double sync[2];				// sync / blank
@@ -0,0 +1,260 @@
+/*
+NES-CVBS
+Copyright (c) 2023 Persune
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <vector>
+
+// output pixel formats the decoder can write directly
+enum PixelFormat {
+    xrgb8888,           // uint32_t 0xXXRRGGBB, X = 0xFF
+    bgra8888,           // bytes B, G, R, A in memory, A = 0xFF
+    rgb565,             // uint16_t 0bRRRRRGGGGGGBBBBB
+    xrgb2101010,        // uint32_t 0bXXRRRRRRRRRRGGGGGGGGGGBBBBBBBBBB, X = 0b11
+    rgb_planar_float,   // three float planes of R, G and B, 0.0 to 1.0
+    yuv420_planar,      // BT.601 Y, Cb and Cr planes, chroma halved horizontally and vertically (I420)
+    yuv422_planar       // BT.601 Y, Cb and Cr planes, chroma halved horizontally (I422)
+};
+
+// the decoder's final store stage. each writer takes a decoded YUV pixel,
+// converts it and stores it at (row, column) of an output buffer
+
+inline void YUVToRGB(float y, float u, float v, float& r, float& g, float& b)
+{
+    r = std::clamp(y + 1.13983f * v, 0.0f, 1.0f);
+    g = std::clamp(y - 0.39465f * u - 0.58060f * v, 0.0f, 1.0f);
+    b = std::clamp(y + 2.03211f * u, 0.0f, 1.0f);
+}
+
+struct PixelWriterXRGB8888 {
+    uint32_t* buffer;
+    size_t width;
+
+    PixelWriterXRGB8888(void* output_buffer, uint16_t output_width, uint16_t /*output_height*/)
+        : buffer((uint32_t*)output_buffer), width(output_width) {}
+
+    void Write(size_t row, size_t column, float y, float u, float v) {
+        float r, g, b;
+        YUVToRGB(y, u, v, r, g, b);
+        buffer[(row * width) + column] = 0xFF000000 |
+            (uint32_t(r * 255.0f + 0.5f) << 16) |
+            (uint32_t(g * 255.0f + 0.5f) << 8) |
+            uint32_t(b * 255.0f + 0.5f);
+    }
+};
+
+struct PixelWriterBGRA8888 {
+    uint8_t* buffer;
+    size_t width;
+
+    PixelWriterBGRA8888(void* output_buffer, uint16_t output_width, uint16_t /*output_height*/)
+        : buffer((uint8_t*)output_buffer), width(output_width) {}
+
+    void Write(size_t row, size_t column, float y, float u, float v) {
+        float r, g, b;
+        YUVToRGB(y, u, v, r, g, b);
+        uint8_t* pixel = &buffer[((row * width) + column) * 4];
+        pixel[0] = uint8_t(b * 255.0f + 0.5f);
+        pixel[1] = uint8_t(g * 255.0f + 0.5f);
+        pixel[2] = uint8_t(r * 255.0f + 0.5f);
+        pixel[3] = 0xFF;
+    }
+};
+
+struct PixelWriterRGB565 {
+    uint16_t* buffer;
+    size_t width;
+
+    PixelWriterRGB565(void* output_buffer, uint16_t output_width, uint16_t /*output_height*/)
+        : buffer((uint16_t*)output_buffer), width(output_width) {}
+
+    void Write(size_t row, size_t column, float y, float u, float v) {
+        float r, g, b;
+        YUVToRGB(y, u, v, r, g, b);
+        buffer[(row * width) + column] = uint16_t(
+            (uint16_t(r * 31.0f + 0.5f) << 11) |
+            (uint16_t(g * 63.0f + 0.5f) << 5) |
+            uint16_t(b * 31.0f + 0.5f));
+    }
+};
+
+struct PixelWriterXRGB2101010 {
+    uint32_t* buffer;
+    size_t width;
+
+    PixelWriterXRGB2101010(void* output_buffer, uint16_t output_width, uint16_t /*output_height*/)
+        : buffer((uint32_t*)output_buffer), width(output_width) {}
+
+    void Write(size_t row, size_t column, float y, float u, float v) {
+        float r, g, b;
+        YUVToRGB(y, u, v, r, g, b);
+        buffer[(row * width) + column] = 0xC0000000 |
+            (uint32_t(r * 1023.0f + 0.5f) << 20) |
+            (uint32_t(g * 1023.0f + 0.5f) << 10) |
+            uint32_t(b * 1023.0f + 0.5f);
+    }
+};
+
+struct PixelWriterRGBPlanarFloat {
+    float* buffer;
+    size_t width;
+    size_t plane_size;
+
+    PixelWriterRGBPlanarFloat(void* output_buffer, uint16_t output_width, uint16_t output_height)
+        : buffer((float*)output_buffer), width(output_width), plane_size(size_t(output_width) * output_height) {}
+
+    void Write(size_t row, size_t column, float y, float u, float v) {
+        size_t index = (row * width) + column;
+        YUVToRGB(y, u, v, buffer[index], buffer[plane_size + index], buffer[(plane_size * 2) + index]);
+    }
+};
+
+// BT.601 limited range, from the decoder's analog YUV
+inline uint8_t YUVToLuma(float y)
+{
+    return uint8_t(std::clamp(16.0f + 219.0f * y, 16.0f, 235.0f) + 0.5f);
+}
+
+inline uint8_t YUVToChroma(float chroma, float chroma_max)
+{
+    return uint8_t(std::clamp(128.0f + 112.0f * (chroma / chroma_max), 16.0f, 240.0f) + 0.5f);
+}
+
+// pairs of horizontal pixels are averaged into one chroma sample
+struct PixelWriterYUV422 {
+    uint8_t* luma;
+    uint8_t* chroma_u;
+    uint8_t* chroma_v;
+    size_t width;
+    size_t chroma_width;
+    float pending_u = 0.0f, pending_v = 0.0f;
+
+    PixelWriterYUV422(void* output_buffer, uint16_t output_width, uint16_t output_height)
+        : luma((uint8_t*)output_buffer), width(output_width), chroma_width((size_t(output_width) + 1) / 2) {
+        chroma_u = luma + (width * output_height);
+        chroma_v = chroma_u + (chroma_width * output_height);
+    }
+
+    void Write(size_t row, size_t column, float y, float u, float v) {
+        luma[(row * width) + column] = YUVToLuma(y);
+        if (!(column & 1) && column + 1 < width) {
+            pending_u = u;
+            pending_v = v;
+            return;
+        }
+        if (column & 1) {
+            u = (u + pending_u) * 0.5f;
+            v = (v + pending_v) * 0.5f;
+        }
+        chroma_u[(row * chroma_width) + (column >> 1)] = YUVToChroma(u, 0.436f);
+        chroma_v[(row * chroma_width) + (column >> 1)] = YUVToChroma(v, 0.615f);
+    }
+};
+
+// 2x2 blocks of pixels are averaged into one chroma sample.
+// rows are written in pairs, so a writer must be handed an even row first
+struct PixelWriterYUV420 {
+    uint8_t* luma;
+    uint8_t* chroma_u;
+    uint8_t* chroma_v;
+    size_t width;
+    size_t height;
+    size_t chroma_width;
+    float pending_u = 0.0f, pending_v = 0.0f;
+    // horizontally averaged chroma of the last even row
+    std::vector<float> pending_row_u, pending_row_v;
+
+    PixelWriterYUV420(void* output_buffer, uint16_t output_width, uint16_t output_height)
+        : luma((uint8_t*)output_buffer), width(output_width), height(output_height), chroma_width((size_t(output_width) + 1) / 2),
+        pending_row_u(chroma_width), pending_row_v(chroma_width) {
+        chroma_u = luma + (width * height);
+        chroma_v = chroma_u + (chroma_width * ((height + 1) / 2));
+    }
+
+    void Write(size_t row, size_t column, float y, float u, float v) {
+        luma[(row * width) + column] = YUVToLuma(y);
+        if (!(column & 1) && column + 1 < width) {
+            pending_u = u;
+            pending_v = v;
+            return;
+        }
+        if (column & 1) {
+            u = (u + pending_u) * 0.5f;
+            v = (v + pending_v) * 0.5f;
+        }
+
+        size_t chroma_column = column >> 1;
+        if (!(row & 1) && row + 1 < height) {
+            pending_row_u[chroma_column] = u;
+            pending_row_v[chroma_column] = v;
+            return;
+        }
+        if (row & 1) {
+            u = (u + pending_row_u[chroma_column]) * 0.5f;
+            v = (v + pending_row_v[chroma_column]) * 0.5f;
+        }
+        chroma_u[((row >> 1) * chroma_width) + chroma_column] = YUVToChroma(u, 0.436f);
+        chroma_v[((row >> 1) * chroma_width) + chroma_column] = YUVToChroma(v, 0.615f);
+    }
+};
+
+// number of rows a thread's share of the field has to start on a multiple of
+template <typename PixelWriter>
+constexpr int PixelWriterRowAlignment = 1;
+template <>
+constexpr int PixelWriterRowAlignment<PixelWriterYUV420> = 2;
+
+// PixelWriterRowAlignment of the writer of a pixel format
+inline int PixelFormatRowAlignment(PixelFormat pixel_format)
+{
+    return pixel_format == yuv420_planar ? PixelWriterRowAlignment<PixelWriterYUV420> : 1;
+}
+
+// same for columns, for writers that share chroma between pixel pairs
+template <typename PixelWriter>
+constexpr int PixelWriterColumnAlignment = 1;
+template <>
+constexpr int PixelWriterColumnAlignment<PixelWriterYUV420> = 2;
+template <>
+constexpr int PixelWriterColumnAlignment<PixelWriterYUV422> = 2;
+
+// size in bytes of an output buffer of the given format
+inline size_t PixelBufferSize(PixelFormat pixel_format, uint16_t width, uint16_t height)
+{
+    size_t pixels = size_t(width) * height;
+    switch (pixel_format) {
+    case rgb565:
+        return pixels * sizeof(uint16_t);
+    case rgb_planar_float:
+        return pixels * 3 * sizeof(float);
+    case yuv420_planar:
+        return pixels + (((size_t(width) + 1) / 2) * ((size_t(height) + 1) / 2) * 2);
+    case yuv422_planar:
+        return pixels + (((size_t(width) + 1) / 2) * height * 2);
+    default:
+        return pixels * sizeof(uint32_t);
+    }
+}
@@ -0,0 +1,133 @@
+/*
+NES-CVBS
+Copyright (c) 2023 Persune
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "SignalDump.h"
+#include "NES-CVBS.h"
+#include <cstring>
+#include <algorithm>
+
+bool SignalDumpWriter::Open(const char* filename, const NES_CVBS& filter)
+{
+    Close();
+
+    std::memcpy(Header.magic, SignalDumpMagic, sizeof(Header.magic));
+    Header.version = SignalDumpVersion;
+    Header.ppu_type = uint32_t(filter.GetPPUType());
+    Header.width = filter.SignalBufferWidth;
+    Header.height = filter.SignalBufferHeight;
+    Header.samples_per_pixel = filter.SignalBufferWidth / filter.FieldBufferWidth;
+    Header.field_count = 0;
+    RecordSize = sizeof(SignalDumpField) + size_t(Header.width) * Header.height * sizeof(uint16_t);
+
+    if (!File.Open(filename, mapped_write) || !File.Resize(sizeof(SignalDumpHeader) + GrowSize)) {
+        File.Close();
+        return false;
+    }
+    std::memcpy(File.Data(), &Header, sizeof(Header));
+    WrittenSize = sizeof(SignalDumpHeader);
+    return true;
+}
+
+bool SignalDumpWriter::WriteField(const NES_CVBS& filter, int dot_phase, bool skip_dot)
+{
+    if (!File.IsOpen() || filter.SignalBufferWidth != Header.width || filter.SignalBufferHeight != Header.height)
+        return false;
+
+    if (WrittenSize + RecordSize > File.Size()) {
+        if (!File.Resize(File.Size() + std::max(GrowSize, RecordSize)))
+            return false;
+    }
+
+    uint8_t* record = File.Data() + WrittenSize;
+    SignalDumpField field = { dot_phase, uint32_t(skip_dot) };
+    std::memcpy(record, &field, sizeof(field));
+    std::memcpy(record + sizeof(field), filter.SignalFieldBuffer, RecordSize - sizeof(field));
+    WrittenSize += RecordSize;
+
+    // keep the header current, so an interrupted capture still reads back up to its last field
+    Header.field_count++;
+    std::memcpy(File.Data(), &Header, sizeof(Header));
+    return true;
+}
+
+void SignalDumpWriter::Close()
+{
+    if (File.IsOpen())
+        File.Resize(WrittenSize);
+    File.Close();
+    WrittenSize = 0;
+}
+
+SignalDumpWriter::~SignalDumpWriter()
+{
+    Close();
+}
+
+bool SignalDumpReader::Open(const char* filename)
+{
+    Close();
+    if (!File.Open(filename, mapped_read) || File.Size() < sizeof(SignalDumpHeader))
+        return false;
+
+    std::memcpy(&Header, File.Data(), sizeof(Header));
+    RecordSize = sizeof(SignalDumpField) + size_t(Header.width) * Header.height * sizeof(uint16_t);
+
+    bool valid = std::memcmp(Header.magic, SignalDumpMagic, sizeof(Header.magic)) == 0 &&
+        Header.version == SignalDumpVersion && Header.width > 0 && Header.height > 0;
+    if (!valid) {
+        Close();
+        return false;
+    }
+    // trust the file over the header for captures cut short
+    Header.field_count = uint32_t(std::min(size_t(Header.field_count), (File.Size() - sizeof(SignalDumpHeader)) / RecordSize));
+    return true;
+}
+
+bool SignalDumpReader::Open(const char* filename, const NES_CVBS& filter)
+{
+    if (!Open(filename))
+        return false;
+    bool matches = Header.ppu_type == uint32_t(filter.GetPPUType()) &&
+        Header.width == filter.SignalBufferWidth && Header.height == filter.SignalBufferHeight;
+    if (!matches)
+        Close();
+    return matches;
+}
+
+void SignalDumpReader::Close()
+{
+    File.Close();
+    Header = {};
+    RecordSize = 0;
+}
+
+const uint16_t* SignalDumpReader::Field(uint32_t field_index, SignalDumpField* field_info) const
+{
+    if (field_index >= Header.field_count)
+        return nullptr;
+
+    const uint8_t* record = File.Data() + sizeof(SignalDumpHeader) + size_t(field_index) * RecordSize;
+    if (field_info != nullptr)
+        std::memcpy(field_info, record, sizeof(SignalDumpField));
+    return (const uint16_t*)(record + sizeof(SignalDumpField));
+}
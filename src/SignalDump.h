@@ -0,0 +1,96 @@
+/*
+NES-CVBS
+Copyright (c) 2023 Persune
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+// streams composite signal fields into a raw memory-mapped file for offline analysis, and reads them back.
+// layout, little-endian:
+//   SignalDumpHeader
+//   per field: SignalDumpField, then width * height uint16_t samples
+// every field record is the same size, so field n is at sizeof(SignalDumpHeader) + n * record size
+
+#include <cstdint>
+#include <cstddef>
+#include "MappedFile.h"
+
+class NES_CVBS;
+
+const char SignalDumpMagic[8] = { 'N', 'E', 'S', 'C', 'V', 'B', 'S', '\0' };
+const uint32_t SignalDumpVersion = 1;
+
+struct SignalDumpHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t ppu_type;
+    uint32_t width;             // samples per line
+    uint32_t height;            // lines per field
+    uint32_t samples_per_pixel;
+    uint32_t field_count;       // updated after every field
+};
+
+struct SignalDumpField {
+    int32_t dot_phase;
+    uint32_t skip_dot;
+};
+
+class SignalDumpWriter
+{
+private:
+    MappedFile File;
+    SignalDumpHeader Header = {};
+    size_t RecordSize = 0;
+    size_t WrittenSize = 0;
+
+    // the file grows by this much at a time, so the mapping is rarely redone
+    static constexpr size_t GrowSize = size_t(64) << 20;
+
+public:
+    // creates the file for fields of the filter's current settings
+    bool Open(const char* filename, const NES_CVBS& filter);
+    // appends the filter's current SignalFieldBuffer, as filtered with dot_phase and skip_dot
+    bool WriteField(const NES_CVBS& filter, int dot_phase, bool skip_dot);
+    // trims the file to the written fields
+    void Close();
+    uint32_t FieldCount() const { return Header.field_count; }
+
+    ~SignalDumpWriter();
+};
+
+class SignalDumpReader
+{
+private:
+    MappedFile File;
+    SignalDumpHeader Header = {};
+    size_t RecordSize = 0;
+
+public:
+    // maps a dump written by SignalDumpWriter, or by a capture tool in the same layout
+    bool Open(const char* filename);
+    // same, but fails unless the dump's PPU type and field size are the filter's, so DecodeSignal() can take its fields
+    bool Open(const char* filename, const NES_CVBS& filter);
+    void Close();
+    const SignalDumpHeader& GetHeader() const { return Header; }
+    uint32_t FieldCount() const { return Header.field_count; }
+    // samples of a field, ready for NES_CVBS::DecodeSignal(), or nullptr past the last field
+    const uint16_t* Field(uint32_t field_index, SignalDumpField* field_info = nullptr) const;
+};
@@ -0,0 +1,146 @@
+/*
+NES-CVBS
+Copyright (c) 2023 Persune
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "SyncSeparator.h"
+#include "NES-CVBS.h"
+#include <cstring>
+#include <algorithm>
+
+SyncSeparator::SyncSeparator(NES_CVBS& filter) : Filter(filter)
+{
+    const PPUTimings& timings = filter.GetTimings();
+    SyncThreshold = filter.GetSyncThreshold();
+    LineWidth = filter.SignalBufferWidth;
+    FieldHeight = filter.SignalBufferHeight;
+    VerticalSyncLine = timings.active_scanlines + timings.postrender_scanlines + timings.postrender_blank_scanlines;
+    EdgeWindow = (timings.horizontal_sync * timings.samples_per_pixel) / 2;
+
+    Line.resize(size_t(LineWidth) + EdgeWindow);
+    Field.resize(size_t(LineWidth) * FieldHeight);
+}
+
+size_t SyncSeparator::Push(const uint16_t* samples, size_t count)
+{
+    size_t index = 0;
+
+    while (index < count && !FieldComplete) {
+        // not locked yet, look for any falling edge
+        if (!EdgeFound) {
+            for (; index < count; index++) {
+                uint16_t sample = samples[index];
+                bool edge = LastSample >= SyncThreshold && sample < SyncThreshold;
+                LastSample = sample;
+                if (edge) {
+                    EdgeFound = true;
+                    Line[0] = sample;
+                    LineFill = 1;
+                    index++;
+                    break;
+                }
+            }
+            continue;
+        }
+
+        // the bulk of the line can't hold the next edge, copy it as is
+        int window_start = LineWidth - EdgeWindow;
+        if (LineFill < window_start) {
+            size_t length = std::min(size_t(window_start - LineFill), count - index);
+            std::memcpy(&Line[LineFill], &samples[index], length * sizeof(uint16_t));
+            LineFill += int(length);
+            index += length;
+            LastSample = samples[index - 1];
+            continue;
+        }
+
+        // inside the window around the expected line end
+        for (; index < count; index++) {
+            uint16_t sample = samples[index];
+            if (LastSample >= SyncThreshold && sample < SyncThreshold) {
+                EndLine(LineFill);
+                Line[0] = sample;
+                LineFill = 1;
+                LastSample = sample;
+                index++;
+                break;
+            }
+            if (LineFill == LineWidth + EdgeWindow) {
+                // no edge, freewheel at the nominal line width and carry the rest over
+                EndLine(LineWidth);
+                std::memmove(&Line[0], &Line[LineWidth], size_t(EdgeWindow) * sizeof(uint16_t));
+                LineFill = EdgeWindow;
+                break;
+            }
+            Line[LineFill++] = sample;
+            LastSample = sample;
+        }
+    }
+    return index;
+}
+
+void SyncSeparator::EndLine(int length)
+{
+    // short lines are padded with their last sample, long lines lose their tail
+    if (length < LineWidth)
+        std::fill(Line.begin() + length, Line.begin() + LineWidth, Line[size_t(length) - 1]);
+
+    // vertical sync pulses cover most of their line, horizontal ones a small part
+    int sync_samples = 0;
+    for (int sample = 0; sample < LineWidth / 2; sample++)
+        sync_samples += Line[sample] < SyncThreshold;
+    bool vertical_sync = sync_samples > LineWidth / 4;
+
+    if (vertical_sync && !PreviousVerticalSync) {
+        if (FieldLine >= 0 && FieldLine != VerticalSyncLine)
+            Resyncs++;
+        FieldLine = VerticalSyncLine;
+    }
+    PreviousVerticalSync = vertical_sync;
+
+    if (FieldLine < 0)
+        return;
+
+    std::memcpy(&Field[size_t(FieldLine) * LineWidth], Line.data(), size_t(LineWidth) * sizeof(uint16_t));
+    if (++FieldLine == FieldHeight) {
+        FieldLine = 0;
+        FieldComplete = !FieldPartial;
+        Fields += !FieldPartial;
+        FieldPartial = false;
+    }
+}
+
+void SyncSeparator::Decode(uint32_t* rgb_buffer)
+{
+    Decode(rgb_buffer, xrgb8888);
+}
+
+void SyncSeparator::Decode(void* output_buffer, PixelFormat pixel_format)
+{
+    // the line phases come from each line's colorburst
+    Filter.DecodeSignal(Field.data(), output_buffer, pixel_format, 0, false);
+    ReleaseField();
+}
+
+void SyncSeparator::ReleaseField()
+{
+    FieldComplete = false;
+}
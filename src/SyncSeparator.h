@@ -0,0 +1,88 @@
+/*
+NES-CVBS
+Copyright (c) 2023 Persune
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+// front end for continuous composite streams, such as captures resampled to the color generator clock.
+// finds the falling edge of each sync pulse, slices the stream into SignalBufferWidth sample lines,
+// and frames them into fields from the long vertical sync pulses, ready for NES_CVBS::DecodeSignal()
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "PixelFormats.h"
+
+class NES_CVBS;
+
+class SyncSeparator
+{
+private:
+    NES_CVBS& Filter;
+
+    // samples below this are sync, halfway between the sync tip and blank levels
+    uint16_t SyncThreshold = 0;
+    int LineWidth = 0;
+    int FieldHeight = 0;
+    // field line of the first vertical sync line
+    int VerticalSyncLine = 0;
+    // how far from LineWidth a sync edge is still taken as the next line's
+    int EdgeWindow = 0;
+
+    // the line being sliced, up to LineWidth + EdgeWindow samples
+    std::vector<uint16_t> Line;
+    int LineFill = 0;
+    std::vector<uint16_t> Field;
+    // next field line to fill, -1 until the first vertical sync is seen
+    int FieldLine = -1;
+    // the field locked on to mid-way is missing its first lines, so it isn't handed out
+    bool FieldPartial = true;
+    bool FieldComplete = false;
+
+    uint16_t LastSample = 0xFFFF;
+    bool EdgeFound = false;
+    bool PreviousVerticalSync = false;
+
+    uint64_t Fields = 0;
+    uint64_t Resyncs = 0;
+
+    void EndLine(int length);
+
+public:
+    // slices streams for the filter's raster. the filter needs sync enabled
+    SyncSeparator(NES_CVBS& filter);
+
+    // consumes samples until a field is complete, and returns how many were consumed.
+    // after a field is complete, nothing more is consumed until it's decoded or released
+    size_t Push(const uint16_t* samples, size_t count);
+    bool FieldReady() const { return FieldComplete; }
+    // the complete field, SignalBufferWidth x SignalBufferHeight samples
+    const uint16_t* GetField() const { return Field.data(); }
+    // decodes the complete field through the filter, then releases it
+    void Decode(uint32_t* rgb_buffer);
+    void Decode(void* output_buffer, PixelFormat pixel_format);
+    void ReleaseField();
+
+    uint64_t FieldCount() const { return Fields; }
+    // vertical syncs that didn't land on the expected field line
+    uint64_t ResyncCount() const { return Resyncs; }
+};
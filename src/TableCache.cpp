@@ -0,0 +1,196 @@
+/*
+NES-CVBS
+Copyright (c) 2023 Persune
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// table cache parts of NES_CVBS, see TableCache.h
+
+#include "NES-CVBS.h"
+#include "TableCache.h"
+#include "MappedFile.h"
+#include <cstring>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+
+std::string NES_CVBS::TableCacheDirectory;
+
+void NES_CVBS::SetTableCacheDirectory(const char* directory)
+{
+    TableCacheDirectory = directory != nullptr ? directory : "";
+}
+
+uint64_t NES_CVBS::TableCacheKey(const CompositeOutputLevel& ppu_voltages) const
+{
+    // FNV-1a, fed field by field so struct padding never gets in
+    uint64_t hash = 0xCBF29CE484222325;
+    auto feed = [&](const void* data, size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            hash ^= ((const uint8_t*)data)[i];
+            hash *= 0x100000001B3;
+        }
+    };
+    auto feed_value = [&](auto value) { feed(&value, sizeof(value)); };
+
+    feed_value(TableCacheVersion);
+    feed_value(int32_t(PPUType));
+    feed_value(uint8_t(PPUSyncEnable));
+    feed_value(SignalBufferWidth);
+    feed_value(OutputBufferWidth);
+    const PPUTimings& t = PPURasterTimings;
+    for (uint16_t value : { t.field_width, t.field_height, t.visible_width, t.visible_height,
+        t.horizontal_sync, t.back_porch_first, t.colorburst, t.back_porch_second, t.front_porch,
+        t.active_scanlines, t.gray_pulse, t.border_left, t.active_pixels, t.border_right,
+        t.postrender_scanlines, t.border_bottom, t.postrender_blank_scanlines, t.vblank,
+        t.vertical_sync_scanlines, t.blank_pulse, t.sync_seperator, t.prerender_blanking_scanlines,
+        t.samples_per_pixel, uint16_t(t.dot_skip), uint16_t(t.colorburst_phase) })
+        feed_value(value);
+    // only doubles, no padding
+    feed(&ppu_voltages, sizeof(ppu_voltages));
+    feed_value(BrightnessDelta);
+    feed_value(ContrastDelta);
+    feed_value(HueDelta);
+    feed_value(SaturationDelta);
+    return hash;
+}
+
+static std::filesystem::path TableCachePath(const std::string& directory, uint64_t key)
+{
+    char name[48];
+    snprintf(name, sizeof(name), "nes-cvbs-%016llx.tables", (unsigned long long)key);
+    return std::filesystem::path(directory) / name;
+}
+
+bool NES_CVBS::LoadTables(uint64_t key)
+{
+    if (TableCacheDirectory.empty())
+        return false;
+
+    MappedFile file;
+    if (!file.Open(TableCachePath(TableCacheDirectory, key).string().c_str(), mapped_read) || file.Size() < sizeof(TableCacheHeader))
+        return false;
+
+    TableCacheHeader header;
+    std::memcpy(&header, file.Data(), sizeof(header));
+    if (std::memcmp(header.magic, TableCacheMagic, sizeof(header.magic)) != 0 || header.version != TableCacheVersion ||
+        header.key != key || header.file_size != file.Size())
+        return false;
+
+    // the kernel and burst layout index into the signal, so they're never taken from the file.
+    // a file that disagrees with the layout of the current buffers is stale
+    InitializeDecoderLayout();
+    size_t lut_size = sizeof(SignalLevelLUT);
+    size_t kernel_length = size_t(DecoderKernelTaps) * DecoderKernelPhases;
+    size_t carrier_length = size_t(12) + DecoderKernelTaps;
+    size_t burst_length = DecoderBurstCos.size();
+    size_t expected_size = sizeof(header) + lut_size +
+        ((carrier_length * 2 + kernel_length + burst_length * 2) * sizeof(float)) +
+        (size_t(DecoderKernelPhases) * sizeof(int32_t));
+    if (header.kernel_taps != uint32_t(DecoderKernelTaps) || header.kernel_phases != uint32_t(DecoderKernelPhases) ||
+        header.kernel_stride != uint32_t(DecoderKernelStride) || header.burst_start != DecoderBurstStart ||
+        header.carrier_length != carrier_length || header.burst_length != burst_length || expected_size != file.Size() ||
+        DecoderBurstStart + burst_length > SignalBufferWidth)
+        return false;
+
+    const uint8_t* data = file.Data() + sizeof(header);
+    auto read = [&](void* destination, size_t size) {
+        std::memcpy(destination, data, size);
+        data += size;
+    };
+    const uint8_t* kernel_offsets = data + lut_size + ((carrier_length * 2 + kernel_length) * sizeof(float));
+    for (int kernel_phase = 0; kernel_phase < DecoderKernelPhases; kernel_phase++) {
+        int32_t offset;
+        std::memcpy(&offset, kernel_offsets + (kernel_phase * sizeof(offset)), sizeof(offset));
+        if (offset != DecoderKernelOffset[kernel_phase])
+            return false;
+    }
+
+    DecoderBlackLevel = header.black_level;
+    DecoderGain = header.gain;
+    DecoderCarrierU.resize(carrier_length);
+    DecoderCarrierV.resize(carrier_length);
+    DecoderKernel.resize(kernel_length);
+
+    read(SignalLevelLUT, lut_size);
+    read(DecoderCarrierU.data(), DecoderCarrierU.size() * sizeof(float));
+    read(DecoderCarrierV.data(), DecoderCarrierV.size() * sizeof(float));
+    read(DecoderKernel.data(), DecoderKernel.size() * sizeof(float));
+    // offsets already checked against the layout
+    data += DecoderKernelOffset.size() * sizeof(int32_t);
+    read(DecoderBurstCos.data(), DecoderBurstCos.size() * sizeof(float));
+    read(DecoderBurstSin.data(), DecoderBurstSin.size() * sizeof(float));
+    return true;
+}
+
+void NES_CVBS::SaveTables(uint64_t key) const
+{
+    if (TableCacheDirectory.empty())
+        return;
+
+    TableCacheHeader header = {};
+    std::memcpy(header.magic, TableCacheMagic, sizeof(header.magic));
+    header.version = TableCacheVersion;
+    header.key = key;
+    header.kernel_taps = uint32_t(DecoderKernelTaps);
+    header.kernel_phases = uint32_t(DecoderKernelPhases);
+    header.kernel_stride = uint32_t(DecoderKernelStride);
+    header.burst_start = DecoderBurstStart;
+    header.carrier_length = uint32_t(DecoderCarrierU.size());
+    header.burst_length = uint32_t(DecoderBurstCos.size());
+    header.black_level = DecoderBlackLevel;
+    header.gain = DecoderGain;
+    header.file_size = uint32_t(sizeof(header) + sizeof(SignalLevelLUT) +
+        ((DecoderCarrierU.size() * 2 + DecoderKernel.size() + DecoderBurstCos.size() * 2) * sizeof(float)) +
+        (DecoderKernelOffset.size() * sizeof(int32_t)));
+
+    // written under a unique name and renamed into place, so workers starting at the same time
+    // never map a half written file
+    std::error_code error;
+    std::filesystem::create_directories(TableCacheDirectory, error);
+    std::filesystem::path path = TableCachePath(TableCacheDirectory, key);
+    std::filesystem::path temporary_path = path;
+    temporary_path += "." + std::to_string(std::random_device()()) + ".tmp";
+    {
+        MappedFile file;
+        if (!file.Open(temporary_path.string().c_str(), mapped_write) || !file.Resize(header.file_size))
+            return;
+
+        uint8_t* data = file.Data();
+        auto write = [&](const void* source, size_t size) {
+            std::memcpy(data, source, size);
+            data += size;
+        };
+        write(&header, sizeof(header));
+        write(SignalLevelLUT, sizeof(SignalLevelLUT));
+        write(DecoderCarrierU.data(), DecoderCarrierU.size() * sizeof(float));
+        write(DecoderCarrierV.data(), DecoderCarrierV.size() * sizeof(float));
+        write(DecoderKernel.data(), DecoderKernel.size() * sizeof(float));
+        for (int offset : DecoderKernelOffset) {
+            int32_t value = offset;
+            write(&value, sizeof(value));
+        }
+        write(DecoderBurstCos.data(), DecoderBurstCos.size() * sizeof(float));
+        write(DecoderBurstSin.data(), DecoderBurstSin.size() * sizeof(float));
+    }
+    std::filesystem::rename(temporary_path, path, error);
+    if (error)
+        std::filesystem::remove(temporary_path, error);
+}
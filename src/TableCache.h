@@ -0,0 +1,56 @@
+/*
+NES-CVBS
+Copyright (c) 2023 Persune
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+// on-disk cache of the tables ApplySettings() generates: the signal level LUT and the decoder's
+// kernel, carriers and burst correlator. one file per settings hash, named nes-cvbs-<hash>.tables.
+// layout, little-endian:
+//   TableCacheHeader
+//   SignalLevelLUT (uint16_t)
+//   DecoderCarrierU, DecoderCarrierV, DecoderKernel (float)
+//   DecoderKernelOffset (int32_t)
+//   DecoderBurstCos, DecoderBurstSin (float)
+// a file with another version, hash or size is stale, and is regenerated and replaced
+
+#include <cstdint>
+#include <cstddef>
+
+const char TableCacheMagic[8] = { 'N', 'E', 'S', 'C', 'V', 'B', 'T', '\0' };
+// bump whenever the generated tables change, so old caches go stale
+const uint32_t TableCacheVersion = 1;
+
+struct TableCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t file_size;
+    uint64_t key;               // hash of everything the tables are generated from
+    uint32_t kernel_taps;
+    uint32_t kernel_phases;
+    uint32_t kernel_stride;
+    int32_t burst_start;
+    uint32_t carrier_length;
+    uint32_t burst_length;
+    float black_level;
+    float gain;
+};
@@ -39,6 +39,11 @@ Rename this file to lodepng.cpp to use it for C++, or to lodepng.c to use it for
 #include <stdlib.h> /* allocations */
 #endif /* LODEPNG_COMPILE_ALLOCATORS */
 
+#ifdef LODEPNG_COMPILE_THREADS
+#include <thread> /* parallel deflate */
+#include <vector>
+#endif /* LODEPNG_COMPILE_THREADS */
+
 #if defined(_MSC_VER) && (_MSC_VER >= 1310) /*Visual Studio: A few warning types are not desired here.*/
 #pragma warning( disable : 4244 ) /*implicit conversions: not warned by gcc -Wall -Wextra and requires too much casts*/
 #pragma warning( disable : 4996 ) /*VS does not like fopen, but fopen_s is not standard C so unusable here*/
@@ -2065,39 +2070,72 @@ static unsigned deflateFixed(LodePNGBitWriter* writer, Hash* hash,
   return error;
 }
 
-static unsigned lodepng_deflatev(ucvector* out, const unsigned char* in, size_t insize,
-                                 const LodePNGCompressSettings* settings) {
+/*deflate block size for btype 1 and 2, on PNGs blocks of 65-262k seem to give most dense encoding*/
+static size_t deflateBlockSize(size_t insize, const LodePNGCompressSettings* settings) {
+  size_t blocksize;
+  if(settings->btype == 1) return insize;
+  blocksize = insize / 8u + 8;
+  if(blocksize < 65536) blocksize = 65536;
+  if(blocksize > 262144) blocksize = 262144;
+  return blocksize;
+}
+
+/*fill the hash chains with the window before start, so that matches can reach back into it
+like they would if everything was deflated in one go*/
+static void primeHash(Hash* hash, const unsigned char* in, size_t start, unsigned windowsize) {
+  size_t pos = start > windowsize ? start - windowsize : 0;
+  unsigned numzeros = 0;
+  for(; pos < start; ++pos) {
+    unsigned hashval = getHash(in, start, pos);
+    if(hashval == 0) {
+      if(numzeros == 0) numzeros = countZeros(in, start, pos);
+      else if(pos + numzeros > start || in[pos + numzeros - 1] != 0) --numzeros;
+    } else {
+      numzeros = 0;
+    }
+    updateHashChain(hash, pos & (windowsize - 1), hashval, (unsigned short)numzeros);
+  }
+}
+
+/*deflates in[start, end) in blocks of blocksize. Unless final, the last block is followed by an empty
+stored block (a sync flush), which ends the output on a byte boundary so the next range can be appended*/
+static unsigned deflateRange(ucvector* out, const unsigned char* in, size_t start, size_t end, size_t blocksize,
+                             const LodePNGCompressSettings* settings, unsigned final) {
   unsigned error = 0;
-  size_t i, blocksize, numdeflateblocks;
+  size_t i, numdeflateblocks;
   Hash hash;
   LodePNGBitWriter writer;
 
   LodePNGBitWriter_init(&writer, out);
 
-  if(settings->btype > 2) return 61;
-  else if(settings->btype == 0) return deflateNoCompression(out, in, insize);
-  else if(settings->btype == 1) blocksize = insize;
-  else /*if(settings->btype == 2)*/ {
-    /*on PNGs, deflate blocks of 65-262k seem to give most dense encoding*/
-    blocksize = insize / 8u + 8;
-    if(blocksize < 65536) blocksize = 65536;
-    if(blocksize > 262144) blocksize = 262144;
-  }
-
-  numdeflateblocks = (insize + blocksize - 1) / blocksize;
+  numdeflateblocks = (end - start + blocksize - 1) / blocksize;
   if(numdeflateblocks == 0) numdeflateblocks = 1;
 
   error = hash_init(&hash, settings->windowsize);
 
+  if(!error && settings->windowsize != 0 && settings->windowsize <= 32768) primeHash(&hash, in, start, settings->windowsize);
+
   if(!error) {
     for(i = 0; i != numdeflateblocks && !error; ++i) {
-      unsigned final = (i == numdeflateblocks - 1);
-      size_t start = i * blocksize;
-      size_t end = start + blocksize;
-      if(end > insize) end = insize;
+      unsigned blockfinal = final && (i == numdeflateblocks - 1);
+      size_t blockstart = start + i * blocksize;
+      size_t blockend = blockstart + blocksize;
+      if(blockend > end) blockend = end;
 
-      if(settings->btype == 1) error = deflateFixed(&writer, &hash, in, start, end, settings, final);
-      else if(settings->btype == 2) error = deflateDynamic(&writer, &hash, in, start, end, settings, final);
+      if(settings->btype == 1) error = deflateFixed(&writer, &hash, in, blockstart, blockend, settings, blockfinal);
+      else if(settings->btype == 2) error = deflateDynamic(&writer, &hash, in, blockstart, blockend, settings, blockfinal);
+    }
+  }
+
+  if(!error && !final) {
+    /*BFINAL 0, BTYPE 00, the rest of the byte is padding, then LEN 0 and NLEN 0xFFFF*/
+    writeBits(&writer, 0, 3);
+    if(!ucvector_resize(out, out->size + 4)) error = 83; /*alloc fail*/
+    else {
+      out->data[out->size - 4] = 0;
+      out->data[out->size - 3] = 0;
+      out->data[out->size - 2] = 255;
+      out->data[out->size - 1] = 255;
     }
   }
 
@@ -2106,6 +2144,89 @@ static unsigned lodepng_deflatev(ucvector* out, const unsigned char* in, size_t
   return error;
 }
 
+#ifdef LODEPNG_COMPILE_THREADS
+static unsigned update_adler32(unsigned adler, const unsigned char* data, unsigned len);
+
+/*adler32 of two pieces of data joined, from the adler32 of each and the length of the second (as in zlib)*/
+static unsigned adler32_combine(unsigned adler1, unsigned adler2, size_t len2) {
+  const unsigned base = 65521u;
+  unsigned rem = (unsigned)(len2 % base);
+  unsigned sum1 = adler1 & 0xffffu;
+  unsigned sum2 = (unsigned)(((unsigned long long)rem * sum1) % base);
+  sum1 += (adler2 & 0xffffu) + base - 1u;
+  sum2 += ((adler1 >> 16u) & 0xffffu) + ((adler2 >> 16u) & 0xffffu) + base - rem;
+  if(sum1 >= base) sum1 -= base;
+  if(sum1 >= base) sum1 -= base;
+  if(sum2 >= (base << 1u)) sum2 -= (base << 1u);
+  if(sum2 >= base) sum2 -= base;
+  return sum1 | (sum2 << 16u);
+}
+
+/*size of the ranges to deflate in parallel, a whole number of blocks and at least 128k.
+Returns 0 if the data is better deflated on one thread*/
+static size_t deflateChunkSize(size_t insize, const LodePNGCompressSettings* settings) {
+  size_t threads = settings->threads ? settings->threads : std::thread::hardware_concurrency();
+  size_t blocksize = deflateBlockSize(insize, settings);
+  size_t chunks = insize / 131072u;
+  if(settings->btype == 0 || settings->btype > 2) return 0;
+  if(chunks > threads) chunks = threads;
+  if(chunks <= 1) return 0;
+  return ((insize + chunks - 1) / chunks + blocksize - 1) / blocksize * blocksize;
+}
+
+/*deflates chunks of the input on their own threads and appends them in order. All but the last
+chunk end with a sync flush. If adler isn't NULL, it gets the adler32 of the input, computed
+by the same threads*/
+static unsigned deflateThreaded(ucvector* out, const unsigned char* in, size_t insize, size_t chunksize,
+                                const LodePNGCompressSettings* settings, unsigned* adler) {
+  unsigned error = 0;
+  size_t i;
+  size_t blocksize = deflateBlockSize(insize, settings);
+  size_t chunks = (insize + chunksize - 1) / chunksize;
+  std::vector<ucvector> outputs(chunks);
+  std::vector<unsigned> errors(chunks, 0), adlers(chunks, 1u);
+  std::vector<std::thread> threads;
+
+  for(i = 0; i != chunks; ++i) {
+    outputs[i] = ucvector_init(NULL, 0);
+    threads.emplace_back([&, i] {
+      size_t start = i * chunksize;
+      size_t end = start + chunksize < insize ? start + chunksize : insize;
+      errors[i] = deflateRange(&outputs[i], in, start, end, blocksize, settings, i == chunks - 1);
+      if(adler) adlers[i] = update_adler32(1u, in + start, (unsigned)(end - start));
+    });
+  }
+  for(i = 0; i != chunks; ++i) threads[i].join();
+
+  if(adler) *adler = adlers[0];
+  for(i = 0; i != chunks; ++i) {
+    if(!error) error = errors[i];
+    if(!error) {
+      size_t pos = out->size;
+      if(!ucvector_resize(out, out->size + outputs[i].size)) error = 83; /*alloc fail*/
+      else lodepng_memcpy(out->data + pos, outputs[i].data, outputs[i].size);
+    }
+    if(adler && i != 0) *adler = adler32_combine(*adler, adlers[i], (i == chunks - 1 ? insize - i * chunksize : chunksize));
+    lodepng_free(outputs[i].data);
+  }
+
+  return error;
+}
+#endif /*LODEPNG_COMPILE_THREADS*/
+
+static unsigned lodepng_deflatev(ucvector* out, const unsigned char* in, size_t insize,
+                                 const LodePNGCompressSettings* settings) {
+  if(settings->btype > 2) return 61;
+  else if(settings->btype == 0) return deflateNoCompression(out, in, insize);
+#ifdef LODEPNG_COMPILE_THREADS
+  {
+    size_t chunksize = deflateChunkSize(insize, settings);
+    if(chunksize) return deflateThreaded(out, in, insize, chunksize, settings, NULL);
+  }
+#endif /*LODEPNG_COMPILE_THREADS*/
+  return deflateRange(out, in, 0, insize, deflateBlockSize(insize, settings), settings, 1);
+}
+
 unsigned lodepng_deflate(unsigned char** out, size_t* outsize,
                          const unsigned char* in, size_t insize,
                          const LodePNGCompressSettings* settings) {
@@ -2252,7 +2373,20 @@ unsigned lodepng_zlib_compress(unsigned char** out, size_t* outsize, const unsig
   unsigned error;
   unsigned char* deflatedata = 0;
   size_t deflatesize = 0;
-
+  unsigned ADLER32 = 0;
+  unsigned adler_done = 0;
+
+#ifdef LODEPNG_COMPILE_THREADS
+  /*the threads deflating the chunks also compute their adler32, which are then combined*/
+  size_t chunksize = settings->custom_deflate ? 0 : deflateChunkSize(insize, settings);
+  if(chunksize) {
+    ucvector v = ucvector_init(NULL, 0);
+    error = deflateThreaded(&v, in, insize, chunksize, settings, &ADLER32);
+    deflatedata = v.data;
+    deflatesize = v.size;
+    adler_done = 1;
+  } else
+#endif /*LODEPNG_COMPILE_THREADS*/
   error = deflate(&deflatedata, &deflatesize, in, insize, settings);
 
   *out = NULL;
@@ -2264,7 +2398,7 @@ unsigned lodepng_zlib_compress(unsigned char** out, size_t* outsize, const unsig
   }
 
   if(!error) {
-    unsigned ADLER32 = adler32(in, (unsigned)insize);
+    if(!adler_done) ADLER32 = adler32(in, (unsigned)insize);
     /*zlib data: 1 byte CMF (CM+CINFO), 1 byte FLG, deflate data, 4 byte ADLER32 checksum of the Decompressed data*/
     unsigned CMF = 120; /*0b01111000: CM 8, CINFO 7. With CINFO 7, any window size up to 32768 can be used.*/
     unsigned FLEVEL = 0;
@@ -2332,13 +2466,14 @@ void lodepng_compress_settings_init(LodePNGCompressSettings* settings) {
   settings->minmatch = 3;
   settings->nicematch = 128;
   settings->lazymatching = 1;
+  settings->threads = 1;
 
   settings->custom_zlib = 0;
   settings->custom_deflate = 0;
   settings->custom_context = 0;
 }
 
-const LodePNGCompressSettings lodepng_default_compress_settings = {2, 1, DEFAULT_WINDOWSIZE, 3, 128, 1, 0, 0, 0};
+const LodePNGCompressSettings lodepng_default_compress_settings = {2, 1, DEFAULT_WINDOWSIZE, 3, 128, 1, 1, 0, 0, 0};
 
 
 #endif /*LODEPNG_COMPILE_ENCODER*/
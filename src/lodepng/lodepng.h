@@ -111,6 +111,14 @@ or comment out LODEPNG_COMPILE_CPP below*/
 #endif
 #endif
 
+/*compile parallel deflate, through std::thread (C++ only)*/
+#ifdef __cplusplus
+#ifndef LODEPNG_NO_COMPILE_THREADS
+/*pass -DLODEPNG_NO_COMPILE_THREADS to the compiler to disable this, or comment out LODEPNG_COMPILE_THREADS below*/
+#define LODEPNG_COMPILE_THREADS
+#endif
+#endif
+
 #ifdef LODEPNG_COMPILE_CPP
 #include <vector>
 #include <string>
@@ -356,6 +364,10 @@ struct LodePNGCompressSettings /*deflate = compress*/ {
   unsigned minmatch; /*minimum lz77 length. 3 is normally best, 6 can be better for some PNGs. Default: 0*/
   unsigned nicematch; /*stop searching if >= this length found. Set to 258 for best compression. Default: 128*/
   unsigned lazymatching; /*use lazy matching: better compression but a bit slower. Default: true*/
+  /*deflate this many chunks of the data on their own threads, each primed with the window before it and ended
+  with a sync flush, then join them into one stream (pigz style). 0 = one per hardware thread. Only with
+  LODEPNG_COMPILE_THREADS, and only for btype 1 and 2. Default: 1*/
+  unsigned threads;
 
   /*use custom zlib encoder instead of built in one (default: null)*/
   unsigned (*custom_zlib)(unsigned char**, size_t*,
@@ -1912,6 +1924,8 @@ symbol.
 Not all changes are listed here, the commit history in github lists more:
 https://github.com/lvandeve/lodepng
 
+*) NES-CVBS: LodePNGCompressSettings::threads deflates chunks of the data in parallel,
+   joined with sync flushes (LODEPNG_COMPILE_THREADS, C++ only).
 *) 10 apr 2023: faster CRC32 implementation, but with larger lookup table.
 *) 13 jun 2022: added support for the sBIT chunk.
 *) 09 jan 2022: minor decoder speed improvements.